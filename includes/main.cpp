@@ -1,4 +1,4 @@
-//g++ -std=c++11 -O3 src/*.cpp includes/main.cpp -o BestBasis.out
+//g++ -std=c++11 -O3 -march=native -pthread src/*.cpp includes/main.cpp -o BestBasis.out
 
 #include <iostream>
 #include <sstream>
@@ -32,7 +32,27 @@ unsigned int k_max = 3; // default value
 /**************************     READ FILE    **********************************/
 /******************************************************************************/
 /**************    READ DATA and STORE them in Nset    ************************/
-vector<pair<__int128_t, unsigned int>> read_datafile128_vect(string datafilename, unsigned int *N, unsigned int r);
+vector<pair<__int128_t, uint64_t>> read_datafile128_vect(string datafilename, uint64_t *N, unsigned int r, unsigned int Nthreads = 1);
+
+/**************    BINARY HISTOGRAM of the DATA (.nset)    ********************/
+bool Is_Nset_file(string datafilename);
+bool write_Nset_file(string nset_filename, const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N);
+vector<pair<__int128_t, uint64_t>> read_Nset_file(string nset_filename, uint64_t *N, unsigned int r);
+
+/**************    OUT-of-CORE READING of LARGE DATAFILES    ******************/
+vector<pair<__int128_t, uint64_t>> read_datafile128_OutOfCore(string datafilename, uint64_t *N, unsigned int r, double memory_MB, unsigned int Nthreads = 1);
+bool write_Nset_OutOfCore(string datafilename, string nset_filename, unsigned int r, double memory_MB, unsigned int Nthreads = 1);
+
+/**************    BIT-SLICED INDEX of the DATA    ****************************/
+BitSliced Build_BitSliced(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, Layout layout = LAYOUT_AUTO);
+bool Open_BitSliced_Index(string datafilename, unsigned int n, Struct_Options Opt, BitSliced& Data, string* index_filename, uint64_t* content_hash);
+bool write_BitSliced_Index(string index_filename, string datafilename, const BitSliced& Data, uint64_t content_hash);
+bool Map_BitSliced_Index(string index_filename, unsigned int n, uint64_t content_hash, BitSliced& Data);
+
+/**************    CO-OCCURRENCE MATRIX of the VARIABLES    *******************/
+Cooccurrence Build_Cooccurrence(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads = 1);
+Cooccurrence Build_Cooccurrence(const BitSliced& Data, unsigned int Nthreads = 1);
+void PrintFile_Cooccurrence(const Cooccurrence& M, string filename);
 
 /******************************************************************************/
 /**************************     Basis  Tools  *********************************/
@@ -40,8 +60,8 @@ vector<pair<__int128_t, unsigned int>> read_datafile128_vect(string datafilename
 bool Is_Basis(vector<Operator128> Basis, unsigned int n);
 vector<Operator128> Invert_Basis(vector<Operator128> Basis, unsigned int n);
 
-void PrintTerm_FinalBasis(vector<Operator128> Basis, unsigned int n, unsigned int N);
-void PrintFile_FinalBasis(vector<Operator128> Basis, unsigned int n, unsigned int N, string filename);
+void PrintTerm_FinalBasis(vector<Operator128> Basis, unsigned int n, uint64_t N);
+void PrintFile_FinalBasis(vector<Operator128> Basis, unsigned int n, uint64_t N, string filename);
 
 void PrintTerm_Basis_inverse(vector<Operator128> Basis, unsigned int r);
 void PrintFile_Basis_inverse(vector<Operator128> Basis, unsigned int n, string filename);
@@ -53,24 +73,25 @@ map<unsigned int, unsigned int> Histo_BasisOpOrder(vector<Operator128> Basis);
 /************************   BASIS SEARCH TOOLS    *****************************/
 /******************************************************************************/
 // Exhaustive Search:
-vector<Operator128> BestBasis_ExhaustiveSearch(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, bool bool_print = false);
+vector<Operator128> BestBasis_ExhaustiveSearch(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, bool bool_print = false, Struct_Options Opt = Struct_Options());
 
 // Fixed Representation up to order `k_max``:
-vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int B_it = 0, unsigned int m_max=1000);
+vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int B_it = 0, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr, const BitSliced* Data_Ri = nullptr);
 
 // Changing representation up to order `k_max``:
-vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k_max=2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int m_max=1000);
+vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k_max=2, string OUTPUT_Data_folder = "", bool bool_print = false, Struct_Options Opt = Struct_Options(), const BitSliced* Data_R0 = nullptr);
 
 /******************************************************************************/
 /*******************     CONVERT DATA TO BEST BASIS    ************************/
 /******************************************************************************/
-void convert_datafile_to_NewBasis(string input_dir, string input_datafilename, unsigned int r, vector<Operator128> Basis);
+void convert_datafile_to_NewBasis(string input_dir, string input_datafilename, unsigned int r, vector<Operator128> Basis, unsigned int Nthreads = 1);
+void convert_Nset_to_NewBasis(const vector<pair<__int128_t, uint64_t>>& Nvect, string output_datafile, unsigned int n, uint64_t N, vector<Operator128> BestBasis_vect, unsigned int Nthreads = 1);
 
 /******************************************************************************/
 /************************ User Interface with Flags ***************************/
 /******************************************************************************/
 
-int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *n, unsigned int *k_max);
+int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *n, unsigned int *k_max, Struct_Options *Opt);
 
 string filename_remove_extension(string filename);
 
@@ -85,6 +106,7 @@ int main(int argc, char *argv[])
     // argv[1] contains the number of variables to read;
     // argv[2] contains flag
     // argv[3] contains kmax
+    // followed by the options of the search (see 'User_Interface.cpp')
 
 // **********************     CREATE FLAG    ************************************ //
 // By default:  flag_search = 1 (for the example)
@@ -93,7 +115,9 @@ int main(int argc, char *argv[])
     // 3 = Varying basis search with given choice of k_max
 
 
-    int flag_search = Read_argument(argc, argv, &input_datafile, &n, &k_max);
+    Struct_Options Opt;  // Options of the search
+
+    int flag_search = Read_argument(argc, argv, &input_datafile, &n, &k_max, &Opt);
 
     if (flag_search == 0) {   return 0;   }   // error flag --> quit
 
@@ -118,12 +142,61 @@ int main(int argc, char *argv[])
     cout << endl << "***********************************  READ THE DATA:  **************************************";
     cout << endl << "*******************************************************************************************" << endl;
 
-	unsigned int N=0;  // will contain the number of datapoints in the dataset
+	uint64_t N=0;  // will contain the number of datapoints in the dataset
+
+    bool nset_input = Is_Nset_file(input_datafile);  // histogram of the data already written in a binary '.nset' file
 
-    vector<pair<__int128_t, unsigned int>> Nvect = read_datafile128_vect(input_directory + input_datafile, &N, n); 
+    if (Opt.write_nset && Opt.ooc_MB > 0 && !nset_input)   // Large datafile: its histogram is written directly in 'INPUT/[datafilename without extension].nset'
+    {
+        write_Nset_OutOfCore(input_directory + input_datafile, input_directory + filename_remove_extension(input_datafile) + ".nset", n, Opt.ooc_MB, Opt.threads);
+        return 0;
+    }
+
+    // Search in fixed or varying representation with the bitsliced engine: the bit-sliced data is mapped from its index file in INPUT/ (if it exists);
+    // the datafile is then not read to build the data (only at the end, to write it in the best basis; a '.nset' file is read, for its histogram).
+    // The index is found from the size, modification time and inode of the datafile, or else from the hash of its content (one pass over the file):
+    bool use_index = Opt.index && !Opt.write_nset && Opt.engine != ENGINE_ROWS && (flag_search == 2 || flag_search == 3);
+    BitSliced Data_R0;
+    string index_filename = "";
+    uint64_t content_hash = 0;
+    bool index_found = use_index && Open_BitSliced_Index(input_directory + input_datafile, n, Opt, Data_R0, &index_filename, &content_hash);
+
+    vector<pair<__int128_t, uint64_t>> Nvect;
+    if (index_found)  { N = Data_R0.N; }
+    if (!index_found || nset_input)
+    {
+        if (nset_input)
+            { Nvect = read_Nset_file(input_directory + input_datafile, &N, n); }
+        else if (Opt.ooc_MB > 0)
+            { Nvect = read_datafile128_OutOfCore(input_directory + input_datafile, &N, n, Opt.ooc_MB, Opt.threads); }
+        else
+            { Nvect = read_datafile128_vect(input_directory + input_datafile, &N, n, Opt.threads); }
+    }
 
 	if (N == 0) { return 0; } // Terminate program if the file can't be found or is empty
 
+    if (use_index && !index_found && index_filename != "")   // first use: build the index, then use it mapped from the file
+    {
+        Data_R0 = Build_BitSliced(Nvect, n, N, Opt.layout);
+        if (write_BitSliced_Index(index_filename, input_directory + input_datafile, Data_R0, content_hash))
+            { Map_BitSliced_Index(index_filename, n, content_hash, Data_R0); }
+        index_found = true;
+    }
+    const BitSliced* Data_R0_ptr = (index_found)? &Data_R0 : nullptr;
+
+    if (Opt.write_nset)   // Write the histogram of the data in 'INPUT/[datafilename without extension].nset' and stop
+    {
+        write_Nset_file(input_directory + filename_remove_extension(input_datafile) + ".nset", Nvect, n, N);
+        return 0;
+    }
+
+    if (Opt.write_pairs)   // Co-occurrence matrix of the data in 'OUTPUT/[datafilename without extension]_Cooccurrence.dat'
+    {
+        cout << endl;
+        Cooccurrence M = (index_found)? Build_Cooccurrence(Data_R0, Opt.threads) : Build_Cooccurrence(Nvect, n, N, Opt.threads);
+        PrintFile_Cooccurrence(M, prefix_datafilename);
+    }
+
 
     vector<Operator128> BestBasis;
 
@@ -139,12 +212,22 @@ int main(int argc, char *argv[])
         cout << "  > The following program search for the Best Basis among all the (2^n-1) possible operators." << endl;
 
         cout << endl << "Important: " << endl;
-        cout << "  > The Exhaustive Search is not recommended for dataset with more than n~20 variables." << endl << endl;
+        if (Opt.wht)
+        {
+            cout << "  > The values of the (2^n-1) operators are obtained from the Walsh-Hadamard transform of the data, in O(n 2^n) operations;" << endl;
+            cout << "  > only the most biased operators are then ranked: the memory needed is about 4*2^n bytes," << endl;
+            cout << "  > and the Exhaustive Search is not recommended for dataset with more than n~34 variables." << endl << endl;
+        }
+        else
+        {
+            cout << "  > The (2^n-1) operators are computed one by one on the data with the chosen engine, then ranked," << endl;
+            cout << "  > and the Exhaustive Search is not recommended for dataset with more than n~24 variables." << endl << endl;
+        }
 
         bool_print = false;
 
         prefix_datafilename += "-exh"; // For output specific to the Dataset
-        BestBasis = BestBasis_ExhaustiveSearch(Nvect, n, N, bool_print);
+        BestBasis = BestBasis_ExhaustiveSearch(Nvect, n, N, bool_print, Opt);
     }
 
     else if (flag_search == 2)
@@ -165,7 +248,7 @@ int main(int argc, char *argv[])
         cout << "Search for the best basis among all operators up to order kmax = " << k_max << "." << endl << endl;
 
         start = chrono::system_clock::now(); 
-        BestBasis = BestBasisSearch_FixedRepresentation(Nvect, n, N, k_max, prefix_datafilename, bool_print);
+        BestBasis = BestBasisSearch_FixedRepresentation(Nvect, n, N, k_max, prefix_datafilename, bool_print, 0, Opt, nullptr, Data_R0_ptr);
         
         end = chrono::system_clock::now();
         elapsed = end - start; 
@@ -183,7 +266,6 @@ int main(int argc, char *argv[])
         cout << endl << "*******************************************************************************************" << endl;
 
         bool_print = false;
-        unsigned int m_max = 50000;
         // By default, k_max = 3;  // largest order of operators to take into account in each representation
 
         prefix_datafilename += ("-var-kmax" + to_string(k_max));  // For output specific to the Dataset
@@ -197,7 +279,7 @@ int main(int argc, char *argv[])
         cout << "(i.e. the basis found in the current representation is identity)." << endl;
 
         start = chrono::system_clock::now(); 
-        BestBasis = BestBasisSearch_Final(Nvect, n, N, k_max, prefix_datafilename, bool_print, m_max); 
+        BestBasis = BestBasisSearch_Final(Nvect, n, N, k_max, prefix_datafilename, bool_print, Opt, Data_R0_ptr); 
 
         end = chrono::system_clock::now();
         elapsed = end - start; 
@@ -225,7 +307,10 @@ int main(int argc, char *argv[])
     cout << endl << "**************************  ORIGINAL DATA WRITTEN IN NEW BASIS  ***************************";
     cout << endl << "*******************************************************************************************" << endl;
 
-    convert_datafile_to_NewBasis(input_directory + input_datafile, OUTPUT_directory + prefix_datafilename, n, BestBasis);
+    if (nset_input)
+        { convert_Nset_to_NewBasis(Nvect, OUTPUT_directory + prefix_datafilename, n, N, BestBasis, Opt.threads); }
+    else
+        { convert_datafile_to_NewBasis(input_directory + input_datafile, OUTPUT_directory + prefix_datafilename, n, BestBasis, Opt.threads); }
 
     cout << endl << "*******************************************************************************************";
     cout << endl << "*************************  PRINT INVERSE BASIS TRANSFORMATION:  ***************************";
@@ -29,47 +29,20 @@ unsigned int bitset_count(__int128_t bool_nb);
 /******************************************************************************/
 /*******************   Convert  Basis  to  F2 Matrix   ************************/
 /******************************************************************************/
-list<unsigned int> RREF_F2(bool** M, int n, int m);
+unsigned int RREF_F2(MatrixF2& M, MatrixF2* M_id = nullptr);
+unsigned int Invert_F2(MatrixF2 M, MatrixF2& M_inv);
 
-// This function returns a binary matrix that has the operators of the basis 'Basis' as columns:
-// Each Operator is a column of the matrix
-// n = Number of spins = number of rows --> 1rst index          //     !! We placed the lowest bit (most to the right) in the top row !!
-// m = Number of basis operators = number of columns --> 2nd index
+// This function returns a binary matrix that has the operators of the basis 'Basis' as rows:
+// Each Operator is a row of the matrix, the first basis operator being the first row;
+// n = Number of spins = number of columns --> bit 'j' of the operator is the column 'j'
 
-bool** Basis_to_MatrixF2(vector<Operator128> Basis, unsigned int n)
+MatrixF2 Basis_to_MatrixF2(const vector<Operator128>& Basis, unsigned int n)
 {
-  unsigned int m = Basis.size();
-  __int128_t Op = 0;
+  MatrixF2 M(Basis.size(), n);
 
-  // Create a Boolean Matrix:
-  bool** M = (bool**) malloc(n*sizeof(bool*));  // n rows --> 1rst index
-  for (int i=0; i<n; i++)
-    {   M[i] = (bool*) malloc(m * sizeof(bool));  }  // m columns --> 2nd index
-
-  unsigned int i = 0; //iteration over the n row;
-  unsigned int j = 0; //iteration over the m columns;
-
-  // Copy the basis operators:
+  unsigned int i = 0; //iteration over the rows;
   for (auto& it_Op : Basis)
-  {
-    Op = it_Op.bin;
-
-    // *****  Filling in each column with a basis operator: ****************
-      // -- Last bit (rightmost) at the bottom; first bit (leftmost) at the top.
-      // -- First basis operator to the Left (i.e. placed first in the matrix) 
-      //    Last basis operator to the Right (placed last)
-      //       --> note that this is the opposite of the convention adopted in writing a state in the new basis
-      //           (there sig_1 = Rightmost bit)
-      // --> One must be careful when re-invert:Matrix to Basis !!!
-
-    for (i=0; i<n; i++)
-    { 
-      M[(n-1-i)][j] = Op & one128;
-      Op >>= 1;
-    }
-
-    j++; // next column
-  } 
+    {   M.Row[i] = it_Op.bin;   i++;   }
 
   return M;
 }
@@ -83,19 +56,14 @@ bool Is_Basis(vector<Operator128> Basis, unsigned int n)
 {
   cout << "-->> Check if the set of operators are independent:" << endl;
   cout << "\t Number of operators analysed: " << Basis.size() << endl;
-  // Convert the basis to a boolean matrix:
-  bool** M_Basis = Basis_to_MatrixF2(Basis, n);
+  // Convert the basis to a binary matrix:
+  MatrixF2 M_Basis = Basis_to_MatrixF2(Basis, n);
 
   // Row Reduction procedure:
-  list<unsigned int> list_lead = RREF_F2(M_Basis, n, Basis.size());
-
-  // Free memory:
-  for (int i=0; i<n; i++)
-    {   free(M_Basis[i]);   } 
-  free(M_Basis);
+  unsigned int rank = RREF_F2(M_Basis);
 
   // Return if the operators are independent or not:
-  if (list_lead.size() == Basis.size())
+  if (rank == Basis.size())
     { 
       cout << "All the operators are independents." << endl << endl;
       return true;  
@@ -104,7 +72,7 @@ bool Is_Basis(vector<Operator128> Basis, unsigned int n)
   else
     { 
       cout << "Not all the operators are independents:";
-      cout << "   (number of independent operators = " << list_lead.size() << ") < (number of operators = " << Basis.size() << " ) " << endl << endl;
+      cout << "   (number of independent operators = " << rank << ") < (number of operators = " << Basis.size() << " ) " << endl << endl;
       return false; 
     }
 }
@@ -112,54 +80,31 @@ bool Is_Basis(vector<Operator128> Basis, unsigned int n)
 /******************************************************************************/
 /**********   INVERT a BASIS: RETURN INVERSE GAUGE TRANSFORMATION   ***********/
 /******************************************************************************/
-vector<Operator128> MatrixF2_to_Basis(bool** M, unsigned int n)
+// Each row of M is turned into an operator:
+vector<Operator128> MatrixF2_to_Basis(const MatrixF2& M)
 {
   vector<Operator128> Basis;
   Operator128 Op;
-  Op.r = n;
+  Op.r = M.m;
   Op.k1 = 0;
 
-  int i = 0; //iteration over the n row;
-  int j = 0; //iteration over the m columns;
-
-  __int128_t Op_bin = 1, state = 0;
-
-  // Copy the basis operators from M to Basis:
-  for (j=(n-1); j>=0; j--) // Copying each column into an operator:
-  // read operators from the right to the left!!!! 
-  // as s1 = rightmost bit = first operator of the Basis_list_invert
-  //    sn = left most bit
+  for (auto& Row : M.Row)
   { 
-    Op_bin = 1; // sig_1 (for i=0) = the lowest bit // sig_n (for i=(n-1)) = the highest bit
-    //Op_bin = one128 << (n - 1);
-    state = 0;
-    for (i=0; i<n; i++) // Turn a column to an operator:
-    {
-      // first element of the column = sig_1 (see function "Basis_to_MatrixF2") 
-            // should be placed as the Righmost bit for the user (cf. convention adopted in writing a state in the new basis: with s_1=[lowest bit] )
-      if(M[i][j] == 1)  { state += Op_bin; }
-      //cout << "Op_bin = " << int_to_bstring(Op_bin, n) << endl; 
-      Op_bin = Op_bin << 1;    
-    } 
-    //j++; // next column
-
-    Op.bin = state;
+    Op.bin = Row;
     Basis.push_back(Op);
-    //cout << int_to_bstring(state, n) << endl;
-    //string int_to_bstring(__int128_t bool_nb, unsigned int n);
   }
 
   return Basis;
 }
 
-pair<int, bool**> RREF_F2_invert(bool** M, int n);
-//bool** RREF_F2_invert(bool** M, int n); // only works for square matrices
-
 // n = number of variables
 // m = number of operators in the independent set
 // if m > n : the set cannot be independent: stop the procedure;
 // if n=m: check if rank=n, then everything is good and return the inverse basis
 // if m < n:  even if it is an independent set, it is not a basis, and may not be invertable: stop the procedure.
+//
+// With the basis operators as rows of the matrix B, the operator 'i' of the inverse basis is the row 'i' of B^{-1}:
+//    it gives the original variable s_i (rightmost bit for i=0) as a product of the basis operators.
 
 vector<Operator128> Invert_Basis(vector<Operator128> Basis, unsigned int n)
 {
@@ -167,29 +112,19 @@ vector<Operator128> Invert_Basis(vector<Operator128> Basis, unsigned int n)
 
   if (Basis.size() == n)
   {
-    bool** M_Basis = Basis_to_MatrixF2(Basis, n);
-
-    // Row Reduction procedure to invert:
-    pair<int, bool**> M_invert = RREF_F2_invert(M_Basis, n);
+    MatrixF2 M_invert;
+    unsigned int rank = Invert_F2(Basis_to_MatrixF2(Basis, n), M_invert);
 
-    if(M_invert.first == n) // M_invert.first = rank
+    if(rank == n)
     {
       cout << "Rank = n = " << n << "\t: this is a basis and can be inverted." << endl << endl;
-      Basis_invert = MatrixF2_to_Basis(M_invert.second, n);
+      Basis_invert = MatrixF2_to_Basis(M_invert);
     }
     else 
     {
-      cout << "The Rank = " << M_invert.first << " is smaller than the number of variables, n = " << n << "\t: this is not a basis." << endl << endl;
+      cout << "The Rank = " << rank << " is smaller than the number of variables, n = " << n << "\t: this is not a basis." << endl << endl;
       //cout << "Note that the inverse transformation provided is therefore incomplete." << endl;
     } 
-
-    // Free memory:
-    for (int i=0; i<n; i++)
-    {   
-      free(M_Basis[i]);   free(M_invert.second[i]);   
-    } 
-    free(M_Basis);
-    free(M_invert.second);  
   }
   else
   {
@@ -202,7 +137,7 @@ vector<Operator128> Invert_Basis(vector<Operator128> Basis, unsigned int n)
 /******************************************************************************/
 /****************   Print Terminal Vector Best Operators  *********************/
 /******************************************************************************/
-void PrintTerm_Basis(vector<Operator128> Basis, unsigned int n, unsigned int N)
+void PrintTerm_Basis(vector<Operator128> Basis, unsigned int n, uint64_t N)
 {
   int i = 1;
   double p1 = 1, LogLi = 0, LogL = 0, Nd = (double) N;
@@ -228,7 +163,7 @@ void PrintTerm_Basis(vector<Operator128> Basis, unsigned int n, unsigned int N)
   cout << endl;
 }
 
-void PrintFile_Basis(vector<Operator128> Basis, unsigned int n, unsigned int N, string filename)
+void PrintFile_Basis(vector<Operator128> Basis, unsigned int n, uint64_t N, string filename)
 {
   string OpSet_filename = OUTPUT_directory + filename + ".dat";
 
@@ -281,7 +216,7 @@ void PrintTerm_OpBasis_Short(vector<Operator128> Basis, unsigned int n)
   cout << endl;
 }
 
-void PrintFile_OpBasis_Short(vector<Operator128> Basis, unsigned int n, unsigned int N, string filename)
+void PrintFile_OpBasis_Short(vector<Operator128> Basis, unsigned int n, uint64_t, string filename)
 {
   string OpSet_filename = OUTPUT_directory + filename + ".dat";
 
@@ -307,7 +242,7 @@ void PrintFile_OpBasis_Short(vector<Operator128> Basis, unsigned int n, unsigned
 }
 
 // ****** FINAL BASIS VERSION:
-void PrintTerm_FinalBasis(vector<Operator128> Basis, unsigned int n, unsigned int N)
+void PrintTerm_FinalBasis(vector<Operator128> Basis, unsigned int n, uint64_t N)
 {
   int i = 1;
   double p1 = 1, LogLi = 0, LogL = 0, Nd = (double) N;
@@ -346,7 +281,7 @@ void PrintTerm_FinalBasis(vector<Operator128> Basis, unsigned int n, unsigned in
 }
 
 
-void PrintFile_FinalBasis(vector<Operator128> Basis, unsigned int n, unsigned int N, string filename)
+void PrintFile_FinalBasis(vector<Operator128> Basis, unsigned int n, uint64_t N, string filename)
 {
   string OpSet_filename = OUTPUT_directory + filename + ".dat";
 
@@ -4,6 +4,8 @@
 
 #include <set>
 #include <vector>
+#include <cstdint>
+#include <cstdlib>
 
 #include <ctime> // for chrono
 #include <ratio> // for chrono
@@ -23,44 +25,153 @@ const __int128_t one128 = 1;
 /************************   Find the lowest bias value  ***********************/
 /******************************************************************************/
 
-set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, double *lowest_bias, bool print = false);
+OpSet128 All_Op_k1(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
 
-Operator128 Value_Op(__int128_t Op_bin, vector<pair<__int128_t, unsigned int>> Nvect, double Nd);
+Operator128 Value_Op(__int128_t Op_bin, const vector<pair<__int128_t, uint64_t>>& Nvect, double Nd);
 
-vector<Operator128> BestBasis_inOpSet(set<Operator128> OpSet, unsigned int n, Struct_LowerBound* LowerBound, unsigned int m=1000);
+// Same functions, using the bit-sliced data:
+Rows128 Build_Rows(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N);
+OpSet128 All_Op_k1(const Rows128& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+Operator128 Value_Op(__int128_t Op_bin, const Rows128& Data, double Nd);
+
+BitSliced Build_BitSliced(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, Layout layout = LAYOUT_AUTO);
+
+OpSet128 All_Op_k1(const BitSliced& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+Operator128 Value_Op(__int128_t Op_bin, const BitSliced& Data, double Nd);
+
+// Same functions, using the Walsh-Hadamard spectrum of the data:
+Spectrum Build_Spectrum(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads = 1);
+
+OpSet128 All_Op_k1(const Spectrum& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+Operator128 Value_Op(__int128_t Op_bin, const Spectrum& Data, double Nd);
+
+unsigned int Spectrum_Bucket_Shift(uint64_t N);
+vector<uint64_t> Spectrum_Histogram(const Spectrum& Data, unsigned int shift, unsigned int Nthreads = 1);
+vector<uint64_t> Spectrum_Extract(const Spectrum& Data, uint64_t W_min, unsigned int Nthreads = 1);
+
+Candidate128 Make_Candidate(__int128_t Op_bin, uint64_t k1);
+void Add_toOpSet(OpSet128& OpSet, vector<Candidate128>& Batch);
+
+void Init_Floor(Struct_Floor& Floor, const OpSet128& OpSet, unsigned int n);
+void Check_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer, Floor_Check& Check);
+void Cut_Floor(OpSet128& OpSet, Struct_Floor& Floor);
+
+vector<Operator128> BestBasis_inOpSet(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound);
 
 /******************************************************************************/
 /*******************************   All Operators  *****************************/
 /****************   Keep only the one with bias larger than LB  ***************/
 /******************************************************************************/
 
-set<Operator128> All_Op_LBk1 (vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, bool print = false)
+// 'Data' is either the bit-sliced data or its row-major copy: the operators are evaluated with the corresponding 'Value_Op'
+template <typename DataType>
+OpSet128 All_Op_LBk1 (const DataType& Data, unsigned int n, uint64_t N, bool print = false)
 {
   double lowest_bias = 0;
 
-  set<Operator128> OpSet = All_Op_k1(Nvect, n, N, &lowest_bias, print);
+  OpSet128 OpSet = All_Op_k1(Data, n, N, &lowest_bias, print);
+  vector<Candidate128> Batch;
   Operator128 Op;
+
+  // Floor raised during the loop (see 'OpSet.cpp'):
+  Struct_Floor Floor;
+  Init_Floor(Floor, OpSet, n);
+  Floor_Check Check;
   double Nd = (double) N;
 
   cout << "-->> Compute ALL the (2^n-1) Operators" << endl;
-  cout << "     Rank the operators with bias larger than lower bound (fixed by the least informative first order operator):" << endl;
+  cout << "     Rank the operators with bias larger than lower bound (fixed by the least informative first order operator, then raised during the loop):" << endl;
 
-  unsigned int Op_bin_max =  (one128 << n) - 1;
+  __int128_t Op_bin_max =  (one128 << n) - 1;
 
-  for (unsigned int Op_bin = 1; Op_bin <= Op_bin_max; Op_bin++)
+  for (__int128_t Op_bin = 1; Op_bin <= Op_bin_max; Op_bin++)
   {
-    Op = Value_Op(Op_bin, Nvect, Nd);
-    if (Op.bias > lowest_bias) { OpSet.insert(Op); } 
+    if (bitset_count(Op_bin) == 1)  {   continue;   }   // the fields are already in the set
+
+    Op = Value_Op(Op_bin, Data, Nd);
+    if (Op.bias > lowest_bias && Floor.accept(Op.k1)) { Batch.push_back(Make_Candidate(Op.bin, Op.k1)); } 
+    if (Batch.size() > Check.Nseen)  {   Check_Floor(Floor, Batch, Check);   }
   }
 
+  Add_toOpSet(OpSet, Batch);
+  Cut_Floor(OpSet, Floor);
   return OpSet;
 }
 
+/******************************************************************************/
+/*****************   Best Basis from the Walsh-Hadamard spectrum  *************/
+/*******************   Keep only the most biased operators  *******************/
+/******************************************************************************/
+// Size of the first window of most biased operators, and factor by which it is enlarged when it is too small:
+const uint64_t Window_min = 4096;
+const uint64_t Window_factor = 8;
+
+// The greedy search for the best basis only looks at the most biased operators, until it has found 'n' independent ones:
+// instead of ranking all the operators with bias larger than the lower bound (up to 2^n operators),
+//   -- the operators are counted in buckets of |W| = |2*K1 - N| (i.e. of bias), from the spectrum;
+//   -- the buckets are taken from the most biased one, until they contain at least 'Window' operators;
+//   -- only the operators of these buckets are ranked, and the best basis is searched among them.
+// The window is a prefix of the full ranking: if it contains 'n' independent operators, the basis is the one of the full ranking;
+// otherwise the window is enlarged, down to the bias of the least biased field (lower bound of the full ranking).
+// Memory = spectrum + window.
+vector<Operator128> BestBasis_inSpectrum(const Spectrum& Data, unsigned int n, uint64_t N, Struct_LowerBound* LB, bool print = false, unsigned int Nthreads = 1)
+{
+  double lowest_bias = 0;
+  OpSet128 Fields = All_Op_k1(Data, n, N, &lowest_bias, print);
+  double Nd = (double) N;
+
+  // Lower bound:  |W| of the least biased field
+  uint64_t W_low = (uint64_t) llabs(((int64_t) N) - 2 * ((int64_t) Fields.at(Fields.size()-1).k1));
+
+  cout << "-->> Histogram of the bias of ALL the (2^n-1) Operators:" << endl;
+
+  unsigned int shift = Spectrum_Bucket_Shift(N);
+  vector<uint64_t> Histo = Spectrum_Histogram(Data, shift, Nthreads);
+
+  uint64_t b_low = W_low >> shift;     // bucket of the lower bound
+  uint64_t b = Histo.size();           // smallest bucket in the window
+  uint64_t Nop = 0;                    // number of operators in the window
+  uint64_t Window = Window_min;
+
+  vector<Operator128> BestBasis;
+
+  while (true)
+  {
+    // Enlarge the window, bucket by bucket:
+    while (b > b_low && Nop < Window)  {   b--;   Nop += Histo[b];   }
+    uint64_t W_min = ((b << shift) > W_low)? (b << shift) : W_low;
+
+    // Rank the operators of the window (same selection as for the full ranking: fields + operators above the lower bound):
+    OpSet128 OpSet;
+    OpSet.N = N;
+    vector<Candidate128> Batch;
+    Operator128 Op;
+    for (uint64_t Op_bin : Spectrum_Extract(Data, W_min, Nthreads))
+    {
+      Op = Value_Op(Op_bin, Data, Nd);
+      if (Op.bias > lowest_bias || bitset_count(Op.bin) == 1) { Batch.push_back(Make_Candidate(Op.bin, Op.k1)); }
+    }
+    Add_toOpSet(OpSet, Batch);
+
+    cout << "     Window of the operators with |2*K1 - N| >= " << W_min << ": 	" << OpSet.size() << " operators ranked" << endl << endl;
+
+    cout << "-->> Search for the Best Basis:\t\t";
+    BestBasis = BestBasis_inOpSet(OpSet, n, LB);
+
+    if (BestBasis.size() == n || b <= b_low)  {   break;   }
+
+    cout << "-->> The window is too small: enlarge it." << endl << endl;
+    Window *= Window_factor;
+  }
+
+  return BestBasis;
+}
+
 /******************************************************************************/
 /***************************   Exhaustive Search  *****************************/
 /******************************************************************************/
 
-vector<Operator128> BestBasis_ExhaustiveSearch(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, bool bool_print = false)
+vector<Operator128> BestBasis_ExhaustiveSearch(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, bool bool_print = false, Struct_Options Opt = Struct_Options())
 {
   auto start = chrono::system_clock::now();
 
@@ -70,20 +181,40 @@ vector<Operator128> BestBasis_ExhaustiveSearch(vector<pair<__int128_t, unsigned
 
 //  cout << "-->> Compute all Operators, with a smallest accepted biased fixed by the least informative first order operator:" << endl;
   cout << endl;
-  set<Operator128> OpSet = All_Op_LBk1 (Nvect, n, N, bool_print);
-
-// Time:
-  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
-  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl; 
-
-  cout << "-->> Search for the Best Basis:\t\t"; // << endl;
-
+  vector<Operator128> BestBasis;
   Struct_LowerBound LB; // Lower Bound Info
   LB.Bias = 0;
-  vector<Operator128> BestBasis = BestBasis_inOpSet(OpSet, n, &LB, 1000); // LB will be over-written with the updated values
+
+  if (Opt.wht)   // all the values at once, in O(n 2^n); then only the most biased operators are ranked
+  {
+    Spectrum Data = Build_Spectrum(Nvect, n, N, Opt.threads);
+    BestBasis = BestBasis_inSpectrum(Data, n, N, &LB, bool_print, Opt.threads);  // LB will be over-written with the updated values
+  }
+  else
+  {
+    OpSet128 OpSet;
+
+    if (Opt.engine != ENGINE_ROWS)   // operators of any order, evaluated one by one: the sparse engine uses the bit-sliced data
+    {
+      BitSliced Data = Build_BitSliced(Nvect, n, N, Opt.layout);
+      OpSet = All_Op_LBk1 (Data, n, N, bool_print);
+    }
+    else
+    {
+      Rows128 Data = Build_Rows(Nvect, n, N);
+      OpSet = All_Op_LBk1 (Data, n, N, bool_print);
+    }
+
+  // Time:
+    auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+    cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl; 
+
+    cout << "-->> Search for the Best Basis:\t\t"; // << endl;
+    BestBasis = BestBasis_inOpSet(OpSet, n, &LB); // LB will be over-written with the updated values
+  }
 
 // Time:
-  end = chrono::system_clock::now();  elapsed = end - start;
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
   cout << "Total elapsed time (in s): " << elapsed.count() << "\t for Exhaustive Search" << endl << endl; 
 
   return BestBasis;
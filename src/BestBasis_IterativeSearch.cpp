@@ -15,16 +15,36 @@ using namespace std;
 /****************     Initial Choice of Operators for Basis    ****************/
 /******************    All operators of order k or smaller    *****************/
 /******************************************************************************/
-set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, double *lowest_bias, bool print = false);
+OpSet128 All_Op_k1(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
 
-void Add_AllOp_kbits_MostBiased(set<Operator128>& OpSet, vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false);
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr);
 
-//void PrintTerm_OpSet(set<Operator128> OpSet);
-void PrintTerm_OpSet(set<Operator128> OpSet, unsigned int n);
-void PrintFile_OpSet(set<Operator128> OpSet, unsigned int n, string filename);
+// Same functions, using the bit-sliced data:
+Rows128 Build_Rows(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N);
+OpSet128 All_Op_k1(const Rows128& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const Rows128& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr);
+
+BitSliced Build_BitSliced(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, Layout layout = LAYOUT_AUTO);
+BitSliced Change_Representation(const BitSliced& Data, const vector<Operator128>& Basis, unsigned int Nthreads = 1);
+
+OpSet128 All_Op_k1(const BitSliced& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const BitSliced& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr);
+
+bool Use_Sparse(const BitSliced& Data, Struct_Options Opt);
+SparseColumns Build_Sparse(const BitSliced& Data, unsigned int Nthreads = 1);
+OpSet128 All_Op_k1(const SparseColumns& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false);
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const SparseColumns& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr);
+
+void PrintTerm_OpSet(const OpSet128& OpSet, unsigned int n);
+void PrintFile_OpSet(const OpSet128& OpSet, unsigned int n, string filename);
 
 // Remove the Operator with too small Bias:
-void CutSmallBias(set<Operator128>& OpSet, Struct_LowerBound LB);
+void CutSmallBias(OpSet128& OpSet, Struct_LowerBound LB);
+
+// Cache of the values of the operators in the original representation R0:
+void Init_Cache(Cache_R0& Cache, double cache_MB);
+void Set_Representation(Cache_R0& Cache, const vector<Operator128>& Basis_R0);
+void Set_Representation(Cache_R0& Cache, unsigned int n);
 
 unsigned int bitset_count(__int128_t bool_nb);
 void int_to_digits_file(__int128_t bool_nb, unsigned int r, std::fstream &file);
@@ -33,15 +53,18 @@ std::string int_to_bstring(__int128_t bool_nb, unsigned int r);
 /******************************************************************************/
 /**************************     Select Best Basis    **************************/
 /******************************************************************************/
-vector<Operator128> BestBasis_inOpSet(set<Operator128> OpSet, unsigned int n, Struct_LowerBound* LowerBound, unsigned int m=1000);
+vector<Operator128> BestBasis_inOpSet(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound);
+
+// Same, when the operators of order < k were already analysed at the previous step, with the best basis 'BestBasis_previous':
+vector<Operator128> BestBasis_inOpSet(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound, const vector<Operator128>& BestBasis_previous, unsigned int k);
 
 /******************************************************************************/
 /**************************     Basis  Tools  *********************************/
 /******************************************************************************/
 bool Is_Basis(vector<Operator128> Basis, unsigned int n);
 
-void PrintTerm_Basis(vector<Operator128> OpVect_Basis, unsigned int n, unsigned int N);
-void PrintFile_Basis(vector<Operator128> OpVect_Basis, unsigned int n, unsigned int N, string filename);
+void PrintTerm_Basis(vector<Operator128> OpVect_Basis, unsigned int n, uint64_t N);
+void PrintFile_Basis(vector<Operator128> OpVect_Basis, unsigned int n, uint64_t N, string filename);
 
 map<unsigned int, unsigned int> Histo_BasisOpOrder(vector<Operator128> Basis);
 
@@ -72,12 +95,41 @@ void SaveFile_Basis(vector<Operator128> Basis, unsigned int n, fstream &file)
 /***************     Search in a Given Representation  Tools  *****************/
 /******************************************************************************/
 
-vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int R_it = 0, unsigned int m_max=1000)
+// 'Cache' (optional): values of the operators already computed in the previous representations, see 'Cache_R0.cpp';
+// it must be set to the current representation of the data 'Nvect'.
+// 'Data_Ri' (optional, bitsliced engine): bit-sliced data already in the current representation; 'Nvect' is then not used.
+vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int R_it = 0, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr, const BitSliced* Data_Ri = nullptr)
 {
   k_max = (k_max<2)?2:k_max;  // k_max must be at least 2;
 
   string out_folder = OUTPUT_Data_folder + "/";
 
+  // Bit-sliced copy of the data (only if this engine, or the sparse one, is selected, and if it is not given):
+  BitSliced Data_Nvect;
+  if (Opt.engine != ENGINE_ROWS && Data_Ri == nullptr)
+  {
+    cout << endl;
+    Data_Nvect = Build_BitSliced(Nvect, n, N, Opt.layout);
+  }
+  const BitSliced& Data = (Data_Ri != nullptr)? (*Data_Ri) : Data_Nvect;
+
+  // Row-major copy of the data (rows engine):
+  Rows128 Rows;
+  if (Opt.engine == ENGINE_ROWS)
+  {
+    cout << endl;
+    Rows = Build_Rows(Nvect, n, N);
+  }
+
+  // Sparse columns of the data, built from its bit-sliced copy (sparse engine, or few 1's in the columns in this representation):
+  SparseColumns Sparse;
+  bool sparse = Use_Sparse(Data, Opt);
+  if (sparse)
+  {
+    cout << endl;
+    Sparse = Build_Sparse(Data, Opt.threads);
+  }
+
   cout << endl << "*****************  FIND THE SMALLEST BIAS OF THE CURRENT BASIS (k = 1):  ******************";
   cout << endl << "*******************************************************************************************" << endl;
 
@@ -86,7 +138,8 @@ vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t,
 
   double Bias_LowerBound = 0.;  // Current lower bound (current lowest bias) is 0. --> we accept all possible bias
 
-  set<Operator128> OpSet = All_Op_k1(Nvect, n, N, &Bias_LowerBound, bool_print);
+  OpSet128 OpSet = (sparse)? All_Op_k1(Sparse, n, N, &Bias_LowerBound, bool_print)
+                 : (Opt.engine != ENGINE_ROWS)? All_Op_k1(Data, n, N, &Bias_LowerBound, bool_print) : All_Op_k1(Rows, n, N, &Bias_LowerBound, bool_print);
 
   //PrintTerm_OpSet(OpSet_B0, n);
   PrintFile_OpSet(OpSet, n, out_folder + "R" + to_string(R_it) + "_k1");
@@ -110,7 +163,12 @@ vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t,
       cout << endl << "****************************  ADD ALL OPERATORS for k = " << k << "  ********************************";
       cout << endl << "*******************************************************************************************" << endl;
 
-      Add_AllOp_kbits_MostBiased(OpSet, Nvect, n, N, k, LB.Bias, bool_print);
+      if (sparse)
+        {   Add_AllOp_kbits_MostBiased(OpSet, Sparse, n, N, k, LB.Bias, bool_print, Opt, Cache);   }
+      else if (Opt.engine != ENGINE_ROWS)
+        {   Add_AllOp_kbits_MostBiased(OpSet, Data, n, N, k, LB.Bias, bool_print, Opt, Cache);   }
+      else
+        {   Add_AllOp_kbits_MostBiased(OpSet, Rows, n, N, k, LB.Bias, bool_print, Opt, Cache);   }
 
       //PrintTerm_OpSet(OpSet, n);
       PrintFile_OpSet(OpSet, n, filename_k);
@@ -118,8 +176,9 @@ vector<Operator128> BestBasisSearch_FixedRepresentation(vector<pair<__int128_t,
       cout << endl << "******************************  SEARCH FOR BEST BASIS:  ***********************************" << endl;
 //    cout << endl << "*******************************************************************************************" << endl;
 
-      BestBasis.clear();
-      BestBasis = BestBasis_inOpSet(OpSet, n, &LB, m_max); // LB will be over-written with the updated values
+      // LB will be over-written with the updated values;
+      // for k > 2, the operators of order < k were already analysed with the basis of the previous step:
+      BestBasis = (k == 2)? BestBasis_inOpSet(OpSet, n, &LB) : BestBasis_inOpSet(OpSet, n, &LB, BestBasis, k);
 
       PrintFile_Basis(BestBasis, n, N, filename_k + "_BestBasis");
 
@@ -155,16 +214,19 @@ __int128_t UpdateOp_inR0(vector<Operator128> BestBasis_R0, __int128_t Opbin_Ri)
   return Op_R0;
 }
 
+MatrixF2 Basis_to_MatrixF2(const vector<Operator128>& Basis, unsigned int n);
+MatrixF2 Product_F2(const MatrixF2& A, const MatrixF2& B);
+
+// Operator 'j' of the i-th Basis in R0 = XOR of the operators of the old basis in R0 selected by the bits of operator 'j' in Ri,
+// i.e.   Matrix[BestBasis_R0_new] = Matrix[BestBasis_Ri] * Matrix[BestBasis_R0_old]   (product over F2, with the operators as rows)
 vector<Operator128> UpdateBasis_inR0(vector<Operator128> BestBasis_R0_old, vector<Operator128> BestBasis_Ri)
 {
-  vector<Operator128> BestBasis_R0_new(BestBasis_Ri); // i-th Basis represented in R0
-  unsigned int i=0;
+  unsigned int n = BestBasis_R0_old.size();
+  MatrixF2 M_R0_new = Product_F2(Basis_to_MatrixF2(BestBasis_Ri, n), Basis_to_MatrixF2(BestBasis_R0_old, n));
 
-  for(auto& Op_Ri:BestBasis_Ri)
-  {
-    BestBasis_R0_new[i].bin = UpdateOp_inR0(BestBasis_R0_old, Op_Ri.bin);
-    i++;
-  }
+  vector<Operator128> BestBasis_R0_new(BestBasis_Ri); // i-th Basis represented in R0
+  for (unsigned int i = 0; i < BestBasis_R0_new.size(); i++)
+    {   BestBasis_R0_new[i].bin = M_R0_new.Row[i];   }
 
   return BestBasis_R0_new;
 }
@@ -172,9 +234,10 @@ vector<Operator128> UpdateBasis_inR0(vector<Operator128> BestBasis_R0_old, vecto
 /******************************************************************************/
 /****************     Search in DIFFERENT REPRESENTATIONS   *******************/
 /******************************************************************************/
-vector<pair<__int128_t, unsigned int>> build_Kvect(vector<pair<__int128_t, unsigned int>> Nvect, list<__int128_t> Basis);
+vector<pair<__int128_t, uint64_t>> build_Kvect(const vector<pair<__int128_t, uint64_t>>& Nvect, const vector<Operator128>& Basis, unsigned int n, unsigned int Nthreads = 1);
 
-vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, unsigned int m_max=1000)
+// 'Data_R0' (optional, bitsliced engine): bit-sliced data in R0 (e.g. mapped from its index file); 'Nvect' is then not used.
+vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k_max = 2, string OUTPUT_Data_folder = "", bool bool_print = false, Struct_Options Opt = Struct_Options(), const BitSliced* Data_R0 = nullptr)
 {
     k_max = (k_max<2)?2:k_max;  // k_max must be at least 2;
 
@@ -184,7 +247,23 @@ vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, unsigned int>>
 
     unsigned int R_it = 0;   // Initial Representation --> R0
 
-    vector<Operator128> BestBasis_R0 = BestBasisSearch_FixedRepresentation(Nvect, n, N, k_max, OUTPUT_Data_folder, bool_print, R_it, m_max);
+    // Values of the operators computed in all the representations, stored with their image in R0:
+    Cache_R0 Cache;
+    Init_Cache(Cache, Opt.cache_MB);
+    Cache_R0* Cache_ptr = (Cache.Nslots_max > 0)? &Cache : nullptr;
+    Set_Representation(Cache, n);
+
+    // Bit-sliced (or sparse) engine: the data is built once in R0, and the changes of representation are done directly on the columns:
+    BitSliced Data_Ri;
+    const BitSliced* Data_ptr = nullptr;
+    if (Opt.engine != ENGINE_ROWS)
+    {
+      cout << endl;
+      Data_Ri = (Data_R0 != nullptr)? (*Data_R0) : Build_BitSliced(Nvect, n, N, Opt.layout);
+      Data_ptr = &Data_Ri;
+    }
+
+    vector<Operator128> BestBasis_R0 = BestBasisSearch_FixedRepresentation(Nvect, n, N, k_max, OUTPUT_Data_folder, bool_print, R_it, Opt, Cache_ptr, Data_ptr);
 
 //Save Basis:
     string Basis_filename = OUTPUT_directory + OUTPUT_Data_folder + "/All_Bases_inRi.dat";
@@ -217,21 +296,22 @@ vector<Operator128> BestBasisSearch_Final(vector<pair<__int128_t, unsigned int>>
       // **** BestBasis_Ri = store the Best Basis in the current representation Ri
       // **** BestBasis_R0 = store the Best Basis in the original representation R0;
       vector<Operator128> BestBasis_Ri(BestBasis_R0);
-      vector<pair<__int128_t, unsigned int>> Kvect(Nvect); // Kvect = data in the current representation
-      list<__int128_t> Basis_li;
+      vector<pair<__int128_t, uint64_t>> Kvect; // Kvect = data in the current representation (not used with the bit-sliced engine)
+      if (Data_ptr == nullptr)  {   Kvect = Nvect;   }
 
       while( !isBasisIdentity ) // if the best basis is not the identity: then continue changing representation
       {
         cout << "-->> Change the representation of the data in the current Best Basis:" << endl;
-        Basis_li.clear();
-        for(auto& Op:BestBasis_Ri)  { Basis_li.push_back(Op.bin);  }  // extract the integer representation of the basis operators:
-    
-        Kvect = build_Kvect(Kvect, Basis_li);
+        if (Data_ptr != nullptr)
+          {   Data_Ri = Change_Representation(Data_Ri, BestBasis_Ri, Opt.threads);   }
+        else
+          {   Kvect = build_Kvect(Kvect, BestBasis_Ri, n, Opt.threads);   }
 
         R_it += 1;   // New basis
 
         BestBasis_Ri.clear();
-        BestBasis_Ri = BestBasisSearch_FixedRepresentation(Kvect, n, N, k_max, OUTPUT_Data_folder, bool_print, R_it, m_max);
+        Set_Representation(Cache, BestBasis_R0);   // variable 'i' of Kvect = operator BestBasis_R0[i] in R0
+        BestBasis_Ri = BestBasisSearch_FixedRepresentation(Kvect, n, N, k_max, OUTPUT_Data_folder, bool_print, R_it, Opt, Cache_ptr, Data_ptr);
 
         PrintTerm_Basis(BestBasis_Ri, n, N);  
         SaveFile_Basis(BestBasis_Ri, n, Basis_file);
@@ -0,0 +1,442 @@
+#include <iostream>
+#include <set>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+const __int128_t one128 = 1;
+const uint64_t one64 = 1;
+
+/******************************************************************************/
+/*******************     BUILD the BIT-SLICED DATA    *************************/
+/******************************************************************************/
+// Set to '1' the bits [r_start, r_end) of the column 'col':
+void set_bit_range(uint64_t* col, uint64_t r_start, uint64_t r_end)
+{
+  while (r_start < r_end)
+  {
+    uint64_t w = r_start / 64;
+    unsigned int b = r_start % 64;
+    unsigned int nb = ((r_end - r_start) < (64 - b))? (unsigned int) (r_end - r_start) : (64 - b);  // nb of bits to set in the word 'w'
+
+    col[w] |= ((nb == 64)? ~((uint64_t) 0) : (((one64 << nb) - 1) << b));
+    r_start += nb;
+  }
+}
+
+// Number of bits needed to write the integer 'a':
+unsigned int nb_bits(uint64_t a)
+{
+  unsigned int nb = 0;
+  for (; a; a >>= 1)  {   nb++;   }
+  return nb;
+}
+
+// Choice of the layout:
+//   for each word of the columns, the RAW layout costs one popcount, and the WEIGHTED layout costs one AND + popcount per plane;
+//   the WEIGHTED layout is therefore cheaper when   Nplanes * |Nset| < N,   i.e. when the data has many repeated states.
+Layout Choose_Layout(uint64_t N, uint64_t Nset_size, unsigned int Nplanes)
+{
+  return (Nplanes * Nset_size < N)? LAYOUT_WEIGHTED : LAYOUT_RAW;
+}
+
+// RAW layout:  a state that appears K times in Nvect is written in K successive rows;
+// WEIGHTED layout:  each state of Nvect is one row, and its count is written in the bit-planes.
+// Complexity = O(n*N/64 + n*|Nset|)
+BitSliced Build_BitSliced(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, Layout layout = LAYOUT_AUTO)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Build the bit-sliced (column) representation of the data:" << endl;
+
+  uint64_t count_max = 0;
+  for (auto& it : Nvect)
+    {   if (it.second > count_max) { count_max = it.second; }   }
+
+  unsigned int Nplanes = nb_bits(count_max);
+
+  if (layout == LAYOUT_AUTO)
+    {   layout = Choose_Layout(N, Nvect.size(), Nplanes);   }
+
+  BitSliced Data;
+  Data.n = n;
+  Data.N = N;
+  Data.weighted = (layout == LAYOUT_WEIGHTED);
+  Data.Nrows = (Data.weighted)? Nvect.size() : N;
+  Data.Nwords = (Data.Nrows + 63) / 64;
+  Data.Col.assign(((size_t) n) * Data.Nwords, 0);
+
+  if (Data.weighted)
+  {
+    Data.Nplanes = Nplanes;
+    Data.Plane.assign(((size_t) Nplanes) * Data.Nwords, 0);
+  }
+
+  uint64_t r = 0;   // first row of the current state
+  uint64_t r_next = 0;
+  for (auto& it : Nvect)
+  {
+    r_next = (Data.weighted)? (r + 1) : (r + it.second);
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if ((it.first >> i) & one128)
+        {   set_bit_range(Data.Col.data() + ((size_t) i) * Data.Nwords, r, r_next);   }
+    }
+    for (unsigned int b = 0; b < Data.Nplanes; b++)
+    {
+      if ((it.second >> b) & 1)
+        {   Data.Plane[((size_t) b) * Data.Nwords + r / 64] |= (one64 << (r % 64));   }
+    }
+    r = r_next;
+  }
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+
+  cout << "\t Layout = " << ((Data.weighted)? "weighted (one row per different state, counts in bit-planes)" : "raw (one row per datapoint)");
+  cout << ", \t N / |Nset| = " << ((double) N) / Nvect.size() << ", \t Number of bit-planes of the counts = " << Nplanes << endl;
+  cout << "\t Number of columns = " << Data.n << ", \t Number of rows = " << Data.Nrows;
+  cout << ", \t Memory = " << ((Data.Col.size() + Data.Plane.size()) * sizeof(uint64_t)) / 1024. / 1024. << " MB" << endl;
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return Data;
+}
+
+/******************************************************************************/
+/*************     CHANGE of REPRESENTATION of the BIT-SLICED DATA    ********/
+/******************************************************************************/
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+// New variable 'j' = value of the operator Basis[j] on the old variables:  new column 'j' = XOR of the old columns selected by Basis[j];
+// the rows (and the bit-planes of the WEIGHTED layout) are unchanged:  no new histogram of the data is needed.
+// Complexity = O(n * (k_max+1) * Nrows/64), where k_max is the largest order of the basis operators
+BitSliced Change_Representation(const BitSliced& Data, const vector<Operator128>& Basis, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  BitSliced Data_new(Data);   // same rows and bit-planes (possibly mapped from an index file), new columns:
+  uint64_t Nwords = Data.Nwords;
+  Data_new.Col_map = nullptr;
+  Data_new.Col.assign(((size_t) Data.n) * Nwords, 0);
+
+  Parallel_Ranges(Basis.size(), Nthreads, Basis.size(), [&](uint64_t, uint64_t j, uint64_t)
+  {
+    uint64_t* col = Data_new.Col.data() + j * Nwords;
+
+    for (unsigned int i = 0; i < Data.n; i++)
+    {
+      if ((Basis[j].bin >> i) & one128)
+      {
+        const uint64_t* col_i = Data.column(i);
+        for (uint64_t w = 0; w < Nwords; w++)  {   col[w] ^= col_i[w];   }
+      }
+    }
+  });
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+  cout << "\t XOR of the bit-sliced columns: \t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return Data_new;
+}
+
+/******************************************************************************/
+/********************     AVERAGES and OBSERVABLES   **************************/
+/******************************************************************************/
+// Number of datapoints in the rows of the word 'w' for which 'parity' = 1:
+inline uint64_t Count_Word(const BitSliced& Data, uint64_t parity, uint64_t w)
+{
+  if (!Data.weighted)  {   return __builtin_popcountll(parity);   }
+
+  uint64_t count = 0;
+  for (unsigned int b = 0; b < Data.Nplanes; b++)
+    {   count += ((uint64_t) __builtin_popcountll(parity & Data.plane(b)[w])) << b;   }
+  return count;
+}
+
+// Number of times an operator is equal to 1 in the dataset:
+//   XOR of the k columns of the operator, then count the number of datapoints for which the result is '1';
+// Complexity = O(k*Nrows/64) for the RAW layout, and O((k+Nplanes)*Nrows/64) for the WEIGHTED layout
+uint64_t K1_Op(const BitSliced& Data, __int128_t Op)
+{
+  const uint64_t* cols[128];   // columns of the variables in Op
+  unsigned int k = 0;
+
+  for (unsigned int i = 0; i < Data.n; i++)
+  {
+    if ((Op >> i) & one128)  {   cols[k++] = Data.column(i);   }
+  }
+
+  uint64_t K1 = 0;
+  uint64_t Nwords = Data.Nwords;
+
+  if (k == 1)
+  {
+    for (uint64_t w = 0; w < Nwords; w++)
+      {   K1 += Count_Word(Data, cols[0][w], w);   }
+  }
+  else if (k == 2)
+  {
+    for (uint64_t w = 0; w < Nwords; w++)
+      {   K1 += Count_Word(Data, cols[0][w] ^ cols[1][w], w);   }
+  }
+  else if (k > 2)
+  {
+    uint64_t parity;
+    for (uint64_t w = 0; w < Nwords; w++)
+    {
+      parity = cols[0][w];
+      for (unsigned int j = 1; j < k; j++)  {   parity ^= cols[j][w];   }
+      K1 += Count_Word(Data, parity, w);
+    }
+  }
+
+  return K1;
+}
+
+// ******* Data averages are taken using ISING convention: ******************** /
+Operator128 Value_Op(__int128_t Op_bin, const BitSliced& Data, double Nd)
+{
+  Operator128 Op;
+
+  Op.bin = Op_bin;
+  Op.k1 = K1_Op(Data, Op.bin);
+  Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+  return Op;
+}
+
+/******************************************************************************/
+/*************   All Operators with k bits on the BIT-SLICED DATA   ***********/
+/******************************************************************************/
+string int_to_bstring(__int128_t bool_nb, unsigned int r);
+void int_to_digits(__int128_t bool_nb, unsigned int r);
+
+void Unrank_Combination(uint64_t rank, unsigned int n, unsigned int k, unsigned int* idx);
+
+// Largest memory (in bytes) allowed for the cache of all order-2 parity columns (meet-in-the-middle for k=4):
+const double MITM_max_memory = 4. * 1024. * 1024. * 1024.;
+
+// Number of datapoints for which (P XOR col) = 1, where 'P' and 'col' are two bitvectors over the rows:
+inline uint64_t K1_XOR(const BitSliced& Data, const uint64_t* P, const uint64_t* col)
+{
+  uint64_t K1 = 0;
+  if (!Data.weighted)
+  {
+    for (uint64_t w = 0; w < Data.Nwords; w++)
+      {   K1 += __builtin_popcountll(P[w] ^ col[w]);   }
+  }
+  else
+  {
+    for (uint64_t w = 0; w < Data.Nwords; w++)
+      {   K1 += Count_Word(Data, P[w] ^ col[w], w);   }
+  }
+  return K1;
+}
+
+// P_out = P XOR col:
+inline void XOR_Words(uint64_t* P_out, const uint64_t* P, const uint64_t* col, uint64_t Nwords)
+{
+  for (uint64_t w = 0; w < Nwords; w++)
+    {   P_out[w] = P[w] ^ col[w];   }
+}
+
+Candidate128 Make_Candidate(__int128_t Op_bin, uint64_t k1);
+void Check_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer, Floor_Check& Check);
+
+// Keep the operator if its bias is larger than 'Bias_LowerBound' and if it is above the floor:
+inline void Insert_Op(vector<Candidate128>& Buffer, __int128_t Op_bin, uint64_t K1, double Nd, double Bias_LowerBound, const Struct_Floor& Floor, unsigned int n, bool print)
+{
+  double bias = fabs((((double) K1) / Nd) -0.5);  //fabs(p1-0.5);
+
+  if (bias > Bias_LowerBound && Floor.accept(K1)) { Buffer.push_back(Make_Candidate(Op_bin, K1)); }
+  if(print) {
+    cout << int_to_bstring(Op_bin, n) << "\t Bias = " << bias << "\t";
+    int_to_digits(Op_bin, n);
+  }
+}
+
+// Depth-first enumeration of the combinations of k variables, in lexicographic order of the indices (i_0 < i_1 < ... < i_{k-1}):
+//   the stack of partial parities  P[d] = XOR of the columns i_0, ..., i_d  is kept for d = 0, ..., k-2,
+//   so that each new operator costs a single XOR + popcount with the column of its last variable;
+//   when the variable i_d changes, only the levels d to k-2 of the stack are recomputed.
+// Evaluates the 'count' combinations starting from the rank 'start' (see 'Unrank_Combination' in 'tools.cpp')
+// With a cache of the values in R0 (R0 != nullptr), the images in R0 of the prefixes are kept with the stack, and the value
+// of each operator is read from the cache when it is there (see 'Cache_R0' in data.h).
+// K = k fixed at compilation (enumeration unrolled), or 0 (see 'Combination' in data.h)
+template <unsigned int K>
+void AllOp_kbits_DFS(vector<Candidate128>& Buffer, vector<Candidate128>& Missed, const BitSliced& Data, unsigned int k_run, double Nd, double Bias_LowerBound, Struct_Floor& Floor, const Cache_R0* R0, bool print, uint64_t start, uint64_t count)
+{
+  unsigned int n = Data.n;  uint64_t Nwords = Data.Nwords;
+
+  Combination<K> C(n, k_run);                   // indices C.idx[] of the variables of the current operator
+  const unsigned int k = C.k();
+  __int128_t Op_prefix[(K > 0)? K : 128]{};     // Op_prefix[d] = operator with the variables i_0, ..., i_d
+  __int128_t Img_prefix[(K > 0)? K : 128]{};    // Img_prefix[d] = image in R0 of Op_prefix[d] (with a cache only)
+  vector<uint64_t> P(((size_t) k) * Nwords);    // stack of partial parities: P[d] is stored in the words [d*Nwords, (d+1)*Nwords)
+  vector<uint64_t> zeros(Nwords, 0);            // parity of the empty operator
+
+  Unrank_Combination(start, n, k, C.idx);
+  const unsigned int* idx = C.idx;
+
+  int d0 = 0;   // first level of the stack to recompute
+  Floor_Check Check;   // checks of the buffer against the floor
+  uint64_t hits = 0;
+
+  while (count > 0)
+  {
+    // Update the stack from the level d0:
+    for (unsigned int l = (unsigned int) d0; l + 1 < k; l++)
+    {
+      XOR_Words(P.data() + ((size_t) l) * Nwords, (l == 0)? zeros.data() : P.data() + ((size_t) (l-1)) * Nwords, Data.column(idx[l]), Nwords);
+      Op_prefix[l] = ((l == 0)? 0 : Op_prefix[l-1]) | (one128 << idx[l]);
+      if (R0)  {   Img_prefix[l] = ((l == 0)? 0 : Img_prefix[l-1]) ^ R0->Row[idx[l]];   }
+    }
+
+    // All the choices of the last variable:
+    const uint64_t* P_last = (k == 1)? zeros.data() : P.data() + ((size_t) (k-2)) * Nwords;
+    __int128_t Op_last = (k == 1)? 0 : Op_prefix[k-2];
+    __int128_t Img_last = (k == 1)? 0 : Img_prefix[k-2];
+
+    for (unsigned int i = idx[k-1]; i < n && count > 0; i++, count--)
+    {
+      uint64_t K1 = (R0)? R0->K1(Img_last ^ R0->Row[i], Missed, &hits, [&]() {   return K1_XOR(Data, P_last, Data.column(i));   }) : K1_XOR(Data, P_last, Data.column(i));
+      Insert_Op(Buffer, Op_last | (one128 << i), K1, Nd, Bias_LowerBound, Floor, n, print);
+    }
+
+    if (Buffer.size() > Check.Nseen)  {   Check_Floor(Floor, Buffer, Check);   }
+
+    // Next combination of the k-1 first variables:
+    d0 = C.next_prefix();
+    if (d0 < 0)  {   break;   }
+  }
+
+  if (R0)  {   R0->Nhits += hits;   }
+}
+
+// Meet-in-the-middle for k = 4:
+//   the parity columns of all the operators of order 2 are computed once and cached;
+//   each operator of order 4 with variables (a < b < c < d) is then the XOR of the cached columns of (a, b) and (c, d).
+struct Cache_Pairs
+{
+  size_t Npairs = 0;
+  vector<uint64_t> Q;           // parity column of the pair 'p' is stored in the words [p*Nwords, (p+1)*Nwords)
+  vector<__int128_t> Q_bin;     // binary representation of the pair 'p'
+  vector<unsigned int> Q_b;     // index 'b' of the pair p = (a, b)
+  vector<size_t> first_pair;    // index of the first pair (a, b) with a = i;  pairs are stored in lexicographic order
+};
+
+Cache_Pairs Build_Cache_Pairs(const BitSliced& Data, unsigned int Nthreads)
+{
+  unsigned int n = Data.n;  uint64_t Nwords = Data.Nwords;
+
+  Cache_Pairs Cache;
+  Cache.Npairs = ((size_t) n) * (n - 1) / 2;
+  Cache.Q.resize(Cache.Npairs * Nwords);
+  Cache.Q_bin.resize(Cache.Npairs);
+  Cache.Q_b.resize(Cache.Npairs);
+  Cache.first_pair.assign(n + 1, Cache.Npairs);
+
+  size_t p = 0;
+  for (unsigned int a = 0; a < n; a++)
+  {
+    Cache.first_pair[a] = p;
+    for (unsigned int b = a + 1; b < n; b++, p++)
+    {
+      Cache.Q_bin[p] = (one128 << a) | (one128 << b);
+      Cache.Q_b[p] = b;
+    }
+  }
+
+  Parallel_Ranges(n, Nthreads, n, [&](uint64_t, uint64_t a, uint64_t)
+  {
+    for (unsigned int b = a + 1; b < n; b++)
+      {   XOR_Words(Cache.Q.data() + (Cache.first_pair[a] + b - a - 1) * Nwords, Data.column(a), Data.column(b), Nwords);   }
+  });
+
+  return Cache;
+}
+
+// Evaluates the 'count' combinations of 4 variables starting from the rank 'start' (lexicographic order):
+void AllOp_4bits_MITM(vector<Candidate128>& Buffer, vector<Candidate128>& Missed, const BitSliced& Data, const Cache_Pairs& Cache, double Nd, double Bias_LowerBound, Struct_Floor& Floor, const Cache_R0* R0, bool print, uint64_t start, uint64_t count)
+{
+  unsigned int n = Data.n;  uint64_t Nwords = Data.Nwords;
+  unsigned int idx[4];
+
+  Unrank_Combination(start, n, 4, idx);
+
+  size_t p1 = Cache.first_pair[idx[0]] + idx[1] - idx[0] - 1;   // pair (a, b)
+  size_t p2 = Cache.first_pair[idx[2]] + idx[3] - idx[2] - 1;   // pair (c, d)
+  Floor_Check Check;   // checks of the buffer against the floor
+  uint64_t hits = 0, K1 = 0;
+
+  while (count > 0)
+  {
+    for (; p2 < Cache.Npairs && count > 0; p2++, count--)   // all pairs (c, d) with b < c < d
+    {
+      auto Compute_K1 = [&]() {   return K1_XOR(Data, Cache.Q.data() + p1 * Nwords, Cache.Q.data() + p2 * Nwords);   };
+      K1 = (R0)? R0->K1(R0->image(Cache.Q_bin[p1] | Cache.Q_bin[p2]), Missed, &hits, Compute_K1) : Compute_K1();
+      Insert_Op(Buffer, Cache.Q_bin[p1] | Cache.Q_bin[p2], K1, Nd, Bias_LowerBound, Floor, n, print);
+    }
+
+    if (Buffer.size() > Check.Nseen)  {   Check_Floor(Floor, Buffer, Check);   }
+
+    p1++;   // next pair (a, b):
+    if (p1 >= Cache.Npairs)  {   break;   }
+    p2 = Cache.first_pair[Cache.Q_b[p1] + 1];
+  }
+
+  if (R0)  {   R0->Nhits += hits;   }
+}
+
+// Loop over all the operators with k bits, evaluated on the bit-sliced data: keep the ones with a bias larger than 'Bias_LowerBound'
+// and above the floor 'Floor' (raised during the loop);  the values already in the cache 'R0' (if any) are not recomputed
+// Returns the number of operators evaluated
+uint64_t AllOp_kbits_Parallel(OpSet128& OpSet, unsigned int n, unsigned int k, bool print, Struct_Options Opt, Struct_Floor& Floor, Cache_R0* Cache, const function<void(vector<Candidate128>&, vector<Candidate128>&, uint64_t, uint64_t)>& Eval_Range);
+
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const BitSliced& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* R0, bool print, Struct_Options Opt)
+{
+  double Nd = (double) N;
+  if (k == 0 || k > n)  {   return 0;   }
+
+  if (Opt.mitm && k == 4)
+  {
+    double memory = ((double) n) * (n - 1) / 2. * Data.Nwords * sizeof(uint64_t);
+
+    if (memory <= MITM_max_memory)
+    {
+      cout << "\t Meet-in-the-middle: cache the parity columns of all the operators of order 2 (" << memory / 1024. / 1024. << " MB)" << endl;
+      Cache_Pairs Cache = Build_Cache_Pairs(Data, Opt.threads);
+
+      return AllOp_kbits_Parallel(OpSet, n, k, print, Opt, Floor, R0, [&](vector<Candidate128>& Buffer, vector<Candidate128>& Missed, uint64_t start, uint64_t count)
+        {   AllOp_4bits_MITM(Buffer, Missed, Data, Cache, Nd, Bias_LowerBound, Floor, R0, print, start, count);   });
+    }
+    else
+      {   cout << "\t Meet-in-the-middle would need " << memory / 1024. / 1024. << " MB: use the depth-first enumeration instead" << endl;   }
+  }
+
+  // Enumeration specialised for k (k <= K_unrolled):
+  return AllOp_kbits_Parallel(OpSet, n, k, print, Opt, Floor, R0, [&](vector<Candidate128>& Buffer, vector<Candidate128>& Missed, uint64_t start, uint64_t count)
+  {
+    switch (k)
+    {
+      case 1:   AllOp_kbits_DFS<1>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 2:   AllOp_kbits_DFS<2>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 3:   AllOp_kbits_DFS<3>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 4:   AllOp_kbits_DFS<4>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 5:   AllOp_kbits_DFS<5>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 6:   AllOp_kbits_DFS<6>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      default:  AllOp_kbits_DFS<0>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);
+    }
+  });
+}
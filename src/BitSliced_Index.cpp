@@ -0,0 +1,356 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include <fcntl.h>    // for open
+#include <dirent.h>   // for opendir, readdir
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close, getpid
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+// Index file of the bit-sliced data:  'INPUT/[datafilename without extension]_[content hash]_n[n]_[layout].bsi'
+//   header of one page (4096 bytes), then the n columns, then the bit-planes of the counts (WEIGHTED layout);
+//   each column and each plane starts on a cache line (the number of words per column is a multiple of 8, padded with 0's).
+// The file is mapped read-only: several searches on the same dataset share the same copy in the page cache.
+// The header also keeps the size, modification time and inode of the datafile when the index was written: while they don't
+// change, the index is found from them, without reading the datafile;  the content hash is only computed otherwise.
+const char Index_magic[4] = {'B', 'S', 'I', 'X'};
+const uint32_t Index_version = 2;
+const size_t Index_header_size = 4096;
+const unsigned int Index_line_words = 8;              // 64 bytes = one cache line
+const size_t Index_hash_block = 64 * 1024 * 1024;     // the content hash is computed by blocks of 64 MB, in parallel
+
+struct File_Stamp
+{
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t inode;
+};
+
+struct Index_Header
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t content_hash;   // hash of the datafile
+  uint32_t n;
+  uint32_t weighted;
+  uint64_t N;
+  uint64_t Nrows;
+  uint64_t Nwords;         // number of words per column (multiple of 'Index_line_words')
+  uint64_t Nplanes;
+  File_Stamp data_stamp;   // stamp of the datafile
+};
+
+/******************************************************************************/
+/*************************   CONTENT HASH of the DATAFILE   *******************/
+/******************************************************************************/
+inline uint64_t Mix64(uint64_t h)
+{
+  h ^= h >> 33;  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t Hash_Bytes(const char* p, size_t size, uint64_t seed)
+{
+  uint64_t h = Mix64(seed ^ size), w = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+  }
+  w = 0;
+  memcpy(&w, p + i, size - i);
+  return Mix64(h ^ w);
+}
+
+// Hash of the content of the file (blocks hashed in parallel, then combined in order);  false if the file can't be read:
+bool Content_Hash(string filename, uint64_t* hash, unsigned int Nthreads = 1)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    if (fd >= 0)  {   close(fd);   }
+    return false;
+  }
+
+  size_t size = file_stat.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)  {   return false;   }
+  madvise(map, size, MADV_SEQUENTIAL);
+
+  const char* Data = (const char*) map;
+  uint64_t Nblocks = (size + Index_hash_block - 1) / Index_hash_block;
+  vector<uint64_t> Hash_block(Nblocks, 0);
+
+  Parallel_Ranges(Nblocks, Nthreads, Nblocks, [&](uint64_t, uint64_t start, uint64_t count)
+  {
+    for (uint64_t b = start; b < start + count; b++)
+    {
+      size_t begin = b * Index_hash_block, end = (begin + Index_hash_block < size)? begin + Index_hash_block : size;
+      Hash_block[b] = Hash_Bytes(Data + begin, end - begin, b);
+    }
+  });
+  munmap(map, size);
+
+  uint64_t h = Mix64(size);
+  for (auto& hb : Hash_block)  {   h = Mix64(h ^ hb) + 0x9E3779B97F4A7C15ULL;   }
+  (*hash) = h;
+  return true;
+}
+
+// Size, modification time and inode of the file;  false if the file doesn't exist:
+bool Stamp_File(string filename, File_Stamp* stamp)
+{
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0)  {   return false;   }
+
+  memset(stamp, 0, sizeof(File_Stamp));
+  stamp->size = file_stat.st_size;
+  stamp->mtime_sec = file_stat.st_mtim.tv_sec;
+  stamp->mtime_nsec = file_stat.st_mtim.tv_nsec;
+  stamp->inode = file_stat.st_ino;
+  return true;
+}
+
+inline bool Same_Stamp(const File_Stamp& a, const File_Stamp& b)
+  {   return a.size == b.size && a.mtime_sec == b.mtime_sec && a.mtime_nsec == b.mtime_nsec && a.inode == b.inode;   }
+
+/******************************************************************************/
+/*************************   WRITE and MAP the INDEX   ************************/
+/******************************************************************************/
+// End of the name of the index file, after the content hash:  '_n[n]_[layout].bsi'
+string Index_suffix(unsigned int n, Layout layout)
+{
+  return "_n" + to_string(n) + ((layout == LAYOUT_RAW)? "_raw" : ((layout == LAYOUT_WEIGHTED)? "_weighted" : "_auto")) + ".bsi";
+}
+
+string Index_filename(string datafilename, uint64_t content_hash, unsigned int n, Layout layout)
+{
+  size_t slash = datafilename.find_last_of('/');
+  size_t dot = datafilename.find('.', (slash == string::npos)? 0 : slash + 1);
+
+  stringstream name;
+  name << datafilename.substr(0, dot) << "_" << hex << setw(16) << setfill('0') << content_hash << dec << Index_suffix(n, layout);
+  return name.str();
+}
+
+// The stamp of the datafile 'datafilename' is stored in the header.
+bool write_BitSliced_Index(string index_filename, string datafilename, const BitSliced& Data, uint64_t content_hash)
+{
+  uint64_t Nwords = ((Data.Nwords + Index_line_words - 1) / Index_line_words) * Index_line_words;
+
+  Index_Header H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.magic, Index_magic, 4);
+  H.version = Index_version;
+  H.content_hash = content_hash;
+  H.n = Data.n;
+  H.weighted = Data.weighted;
+  H.N = Data.N;
+  H.Nrows = Data.Nrows;
+  H.Nwords = Nwords;
+  H.Nplanes = Data.Nplanes;
+  Stamp_File(datafilename, &H.data_stamp);
+
+  string tmp_filename = index_filename + ".tmp" + to_string(getpid());
+  ofstream file(tmp_filename.c_str(), ios::out | ios::binary);
+  if (!file.is_open())
+  {
+    cout << "--->> Unable to write the index file: \"" << index_filename << "\"" << endl << endl;
+    return false;
+  }
+
+  vector<char> Header(Index_header_size, 0);
+  memcpy(Header.data(), &H, sizeof(H));
+  file.write(Header.data(), Header.size());
+
+  vector<uint64_t> Padding(Nwords - Data.Nwords, 0);
+  for (unsigned int i = 0; i < Data.n; i++)
+  {
+    file.write((const char*) Data.column(i), ((size_t) Data.Nwords) * sizeof(uint64_t));
+    file.write((const char*) Padding.data(), Padding.size() * sizeof(uint64_t));
+  }
+  for (unsigned int b = 0; b < Data.Nplanes; b++)
+  {
+    file.write((const char*) Data.plane(b), ((size_t) Data.Nwords) * sizeof(uint64_t));
+    file.write((const char*) Padding.data(), Padding.size() * sizeof(uint64_t));
+  }
+  file.close();
+
+  if (!file || rename(tmp_filename.c_str(), index_filename.c_str()) != 0)
+  {
+    remove(tmp_filename.c_str());
+    cout << "--->> Unable to write the index file: \"" << index_filename << "\"" << endl << endl;
+    return false;
+  }
+
+  cout << "--->> Bit-sliced index written in the file: \"" << index_filename << "\"" << endl << endl;
+  return true;
+}
+
+// Map the index file (read-only) in 'Data';  false if the file doesn't exist or doesn't match the datafile:
+bool Map_BitSliced_Index(string index_filename, unsigned int n, uint64_t content_hash, BitSliced& Data)
+{
+  int fd = open(index_filename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0 || ((size_t) file_stat.st_size) < Index_header_size)
+  {
+    if (fd >= 0)  {   close(fd);   }
+    return false;
+  }
+
+  size_t size = file_stat.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)  {   return false;   }
+
+  Index_Header H;
+  memcpy(&H, map, sizeof(H));
+  bool valid = (memcmp(H.magic, Index_magic, 4) == 0) && H.version == Index_version && H.content_hash == content_hash && H.n == n
+                && H.Nwords % Index_line_words == 0 && size == Index_header_size + (H.n + H.Nplanes) * H.Nwords * sizeof(uint64_t);
+  if (!valid)
+  {
+    munmap(map, size);
+    return false;
+  }
+
+  const uint64_t* Words = (const uint64_t*) (((const char*) map) + Index_header_size);
+
+  Data = BitSliced();
+  Data.n = H.n;
+  Data.N = H.N;
+  Data.Nrows = H.Nrows;
+  Data.Nwords = H.Nwords;
+  Data.weighted = H.weighted;
+  Data.Nplanes = (unsigned int) H.Nplanes;
+  Data.Col_map = Words;
+  Data.Plane_map = (H.Nplanes > 0)? Words + ((size_t) H.n) * H.Nwords : nullptr;
+  Data.Mapping = shared_ptr<const void>(map, [size](const void* p) {   munmap((void*) p, size);   });
+
+  return true;
+}
+
+// Header of the index file;  false if it can't be read or is not an index of the current version:
+bool read_Index_Header(string index_filename, Index_Header* H)
+{
+  ifstream file(index_filename.c_str(), ios::in | ios::binary);
+  if (!file.is_open() || !file.read((char*) H, sizeof(Index_Header)))  {   return false;   }
+  return (memcmp(H->magic, Index_magic, 4) == 0) && H->version == Index_version;
+}
+
+// Replace the stamp of the datafile in the header of the index (datafile touched or copied, with the same content):
+void Update_Index_Stamp(string index_filename, const File_Stamp& stamp)
+{
+  int fd = open(index_filename.c_str(), O_WRONLY);
+  if (fd < 0)  {   return;   }
+  if (pwrite(fd, &stamp, sizeof(File_Stamp), offsetof(Index_Header, data_stamp)) != (ssize_t) sizeof(File_Stamp))
+    {   cout << "\t Unable to update the stamp of the datafile in the index file." << endl;   }
+  close(fd);
+}
+
+// Look in the directory of the datafile for an index 'Index_filename(datafilename, [any hash], n, layout)' with the stamp 'stamp':
+// true if it is found, with its name and its content hash.
+bool Find_Index_byStamp(string datafilename, unsigned int n, Layout layout, const File_Stamp& stamp, string* index_filename, uint64_t* content_hash)
+{
+  size_t slash = datafilename.find_last_of('/');
+  size_t begin = (slash == string::npos)? 0 : slash + 1;
+  string directory = (slash == string::npos)? "." : datafilename.substr(0, slash);
+  string prefix = datafilename.substr(begin, datafilename.find('.', begin) - begin) + "_";
+  string suffix = Index_suffix(n, layout);
+
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr)  {   return false;   }
+
+  bool found = false;
+  Index_Header H;
+  for (struct dirent* entry = readdir(dir); entry != nullptr && !found; entry = readdir(dir))
+  {
+    string name = entry->d_name;
+    if (name.size() != prefix.size() + 16 + suffix.size() || name.compare(0, prefix.size(), prefix) != 0
+        || name.compare(prefix.size() + 16, suffix.size(), suffix) != 0)  {   continue;   }
+
+    string filename = datafilename.substr(0, begin) + name;
+    if (read_Index_Header(filename, &H) && H.n == n && Same_Stamp(H.data_stamp, stamp))
+    {
+      (*index_filename) = filename;
+      (*content_hash) = H.content_hash;
+      found = true;
+    }
+  }
+  closedir(dir);
+  return found;
+}
+
+/******************************************************************************/
+/*****************************   INDEX of a DATAFILE   ************************/
+/******************************************************************************/
+// Look for the index of the datafile (same content, same 'n' and same choice of layout):
+// true if it is found and mapped in 'Data';  the name of the index file and the content hash are returned in any case.
+// The index is first looked for from the stamp of the datafile (size, modification time and inode), in O(1);
+// the datafile is only read to compute its content hash if no index has this stamp (first run, or datafile modified or copied).
+bool Open_BitSliced_Index(string datafilename, unsigned int n, Struct_Options Opt, BitSliced& Data, string* index_filename, uint64_t* content_hash)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << endl << "--->> Look for the bit-sliced index of the datafile: \"" << datafilename << "\"" << endl;
+
+  (*index_filename) = "";
+  File_Stamp stamp = File_Stamp();
+  bool found = Stamp_File(datafilename, &stamp) && Find_Index_byStamp(datafilename, n, Opt.layout, stamp, index_filename, content_hash)
+                && Map_BitSliced_Index(*index_filename, n, *content_hash, Data);
+
+  if (!found)
+  {
+    if (!Content_Hash(datafilename, content_hash, Opt.threads))
+    {
+      cout << "\t The datafile can't be read." << endl;
+      return false;
+    }
+    (*index_filename) = Index_filename(datafilename, *content_hash, n, Opt.layout);
+
+    found = Map_BitSliced_Index(*index_filename, n, *content_hash, Data);
+    if (found)  {   Update_Index_Stamp(*index_filename, stamp);   }   // same content: the next runs find the index from the stamp
+  }
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+
+  if (found)
+  {
+    cout << "\t Index found: \"" << (*index_filename) << "\":  the bit-sliced data is mapped from this file." << endl;
+    cout << "\t Layout = " << ((Data.weighted)? "weighted" : "raw") << ", \t N = " << Data.N << ", \t Number of rows = " << Data.Nrows;
+    cout << ", \t Number of bit-planes of the counts = " << Data.Nplanes << endl;
+  }
+  else
+    {   cout << "\t No index for this datafile yet:  it will be written in \"" << (*index_filename) << "\"" << endl;   }
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return found;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+/******************************************************************************/
+/*********************   CACHE of the VALUES of the OPERATORS in R0   *********/
+/******************************************************************************/
+// Memory cap: the number of slots is the largest power of 2 that fits in 'cache_MB' MB (see 'Cache_R0' in data.h)
+void Init_Cache(Cache_R0& Cache, double cache_MB)
+{
+  size_t Nslots_cap = (size_t) (cache_MB * 1024. * 1024. / sizeof(Candidate128));
+
+  Cache.Nslots_max = 0;
+  if (Nslots_cap >= 2)
+  {
+    Cache.Nslots_max = 1;
+    while (2 * Cache.Nslots_max <= Nslots_cap)  {   Cache.Nslots_max *= 2;   }
+  }
+
+  Cache.Nentries = 0;
+  Cache.Slot.clear();
+  Cache.Nhits = 0;
+}
+
+// Current representation: the variable 'i' of the data is the operator Basis_R0[i] of the original representation
+void Set_Representation(Cache_R0& Cache, const vector<Operator128>& Basis_R0)
+{
+  for (unsigned int i = 0; i < 128; i++)
+    {   Cache.Row[i] = (i < Basis_R0.size())? Basis_R0[i].bin : 0;   }
+}
+
+// Original representation:
+void Set_Representation(Cache_R0& Cache, unsigned int n)
+{
+  const __int128_t one128 = 1;
+  for (unsigned int i = 0; i < 128; i++)
+    {   Cache.Row[i] = (i < n)? (one128 << i) : 0;   }
+}
+
+// Number of new values that can still be stored:
+size_t Cache_Room(const Cache_R0& Cache)
+  {   return Cache.Nslots_max / 2 - Cache.Nentries;   }
+
+// Insert a value in the table (the table must have an empty slot):
+inline void Cache_Insert(Cache_R0& Cache, const Candidate128& C)
+{
+  size_t s = Cache.hash(C.bin());
+  for (; Cache.Slot[s].bin_lo | Cache.Slot[s].bin_hi; s = (s + 1) & (Cache.Slot.size() - 1))
+  {
+    if (Cache.Slot[s].bin_lo == C.bin_lo && Cache.Slot[s].bin_hi == C.bin_hi)  {   return;   }   // already stored
+  }
+  Cache.Slot[s] = C;
+  Cache.Nentries++;
+}
+
+// Add the values computed during an enumeration to the cache:
+// the table is doubled (and re-hashed) while it is more than half full, until the memory cap.
+void Cache_Insert(Cache_R0& Cache, vector<vector<Candidate128>>& Missed)
+{
+  if (Cache.Nslots_max == 0)  {   return;   }
+
+  size_t Nnew = 0;
+  for (auto& M : Missed)  {   Nnew += M.size();   }
+
+  size_t Nslots = (Cache.Slot.empty())? 1024 : Cache.Slot.size();
+  while (2 * (Cache.Nentries + Nnew) > Nslots && 2 * Nslots <= Cache.Nslots_max)  {   Nslots *= 2;   }
+  if (Nslots > Cache.Nslots_max)  {   Nslots = Cache.Nslots_max;   }
+
+  if (Nslots != Cache.Slot.size())
+  {
+    vector<Candidate128> Old(Nslots, Candidate128{0, 0, 0});
+    Old.swap(Cache.Slot);
+    Cache.Nentries = 0;
+    for (auto& C : Old)
+      {   if (C.bin_lo | C.bin_hi)  {   Cache_Insert(Cache, C);   }   }
+  }
+
+  for (auto& M : Missed)
+  {
+    for (auto& C : M)
+    {
+      if (2 * (Cache.Nentries + 1) > Cache.Slot.size())  {   break;   }   // full
+      Cache_Insert(Cache, C);
+    }
+    vector<Candidate128>().swap(M);
+  }
+}
@@ -0,0 +1,256 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+void K1_Block(const Rows128& Data, const __int128_t* Op, size_t B, uint64_t* K1);
+const __int128_t one128 = 1;
+
+// Bit-matrix product by blocks: the columns are read by tiles of 'Pairs_tile_words' words (4 kB per column),
+// and all the pairs (i, j) are computed on a tile before the next tile is read.
+const uint64_t Pairs_tile_words = 512;
+
+// Sum of the matrices of the ranges, then copy of the upper triangle in the lower triangle:
+Cooccurrence Sum_Cooccurrence(const vector<vector<uint64_t>>& C_range, unsigned int n, uint64_t N)
+{
+  Cooccurrence M;
+  M.n = n;
+  M.N = N;
+  M.C.assign(((size_t) n) * n, 0);
+
+  for (auto& C : C_range)
+  {
+    for (size_t p = 0; p < M.C.size(); p++)  {   M.C[p] += C[p];   }
+  }
+  for (unsigned int i = 0; i < n; i++)
+  {
+    for (unsigned int j = 0; j < i; j++)  {   M.C[((size_t) i) * n + j] = M.C[((size_t) j) * n + i];   }
+  }
+  return M;
+}
+
+void Print_Cooccurrence_Info(const Cooccurrence& M, chrono::duration<double> elapsed)
+{
+  cout << "\t Number of variables = " << M.n << ", \t Number of pairs = " << ((uint64_t) M.n) * (M.n - 1) / 2;
+  cout << ", \t Memory = " << (M.C.size() * sizeof(uint64_t)) / 1024. / 1024. << " MB" << endl;
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+}
+
+/******************************************************************************/
+/*****************   CO-OCCURRENCE MATRIX of the BIT-SLICED DATA   ************/
+/******************************************************************************/
+// c_ij = popcount(col_i & col_j)  (RAW layout),  or  sum_b 2^b * popcount(col_i & col_j & plane_b)  (WEIGHTED layout)
+// The tiles of words are shared between the threads, each one with its own matrix.
+// Complexity = O(n^2 * Nwords)  (times the number of bit-planes for the WEIGHTED layout)
+Cooccurrence Build_Cooccurrence(const BitSliced& Data, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Co-occurrence matrix of the variables (bit-matrix product of the columns of the bit-sliced data):" << endl;
+
+  unsigned int n = Data.n;
+  if (Nthreads < 1)  {   Nthreads = 1;   }
+  uint64_t Ntiles = (Data.Nwords + Pairs_tile_words - 1) / Pairs_tile_words;
+  vector<vector<uint64_t>> C_range(Nthreads, vector<uint64_t>(((size_t) n) * n, 0));
+
+  Parallel_Ranges(Ntiles, Nthreads, Nthreads, [&](uint64_t range, uint64_t start, uint64_t count)
+  {
+    vector<uint64_t>& C = C_range[range];
+    for (uint64_t t = start; t < start + count; t++)
+    {
+      uint64_t w_start = t * Pairs_tile_words;
+      uint64_t w_end = (w_start + Pairs_tile_words < Data.Nwords)? w_start + Pairs_tile_words : Data.Nwords;
+
+      for (unsigned int i = 0; i < n; i++)
+      {
+        const uint64_t* col_i = Data.column(i);
+        for (unsigned int j = i; j < n; j++)
+        {
+          const uint64_t* col_j = Data.column(j);
+          uint64_t c = 0;
+          if (!Data.weighted)
+          {
+            for (uint64_t w = w_start; w < w_end; w++)  {   c += __builtin_popcountll(col_i[w] & col_j[w]);   }
+          }
+          else
+          {
+            for (unsigned int b = 0; b < Data.Nplanes; b++)
+            {
+              const uint64_t* plane = Data.plane(b);
+              uint64_t c_b = 0;
+              for (uint64_t w = w_start; w < w_end; w++)  {   c_b += __builtin_popcountll(col_i[w] & col_j[w] & plane[w]);   }
+              c += (c_b << b);
+            }
+          }
+          C[((size_t) i) * n + j] += c;
+        }
+      }
+    }
+  });
+
+  Cooccurrence M = Sum_Cooccurrence(C_range, n, Data.N);
+
+  auto end = chrono::system_clock::now();
+  Print_Cooccurrence_Info(M, end - start);
+
+  return M;
+}
+
+/******************************************************************************/
+/*****************   CO-OCCURRENCE MATRIX of the STATES (rows)   **************/
+/******************************************************************************/
+// Weighted product  X^T diag(counts) X  of the matrix X of the states (one row per different state):
+// each state adds its count to all the pairs of its variables equal to 1 (upper triangle, diagonal included).
+// Complexity = O(|Nset| * m^2), where m is the number of variables equal to 1 in a state
+template <typename StateFunction>
+Cooccurrence Build_Cooccurrence_States(uint64_t Nstates, unsigned int n, uint64_t N, unsigned int Nthreads, StateFunction State)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Co-occurrence matrix of the variables (weighted product of the matrix of the states):" << endl;
+
+  if (Nthreads < 1)  {   Nthreads = 1;   }
+  vector<vector<uint64_t>> C_range(Nthreads, vector<uint64_t>(((size_t) n) * n, 0));
+
+  Parallel_Ranges(Nstates, Nthreads, Nthreads, [&](uint64_t range, uint64_t start, uint64_t count)
+  {
+    uint64_t* C = C_range[range].data();
+    unsigned int bits[128];
+    uint64_t lo = 0, hi = 0, K = 0;
+
+    for (uint64_t r = start; r < start + count; r++)
+    {
+      State(r, &lo, &hi, &K);
+
+      unsigned int m = 0;   // variables equal to 1, in increasing order
+      for (; lo; lo &= lo - 1)  {   bits[m++] = __builtin_ctzll(lo);   }
+      for (; hi; hi &= hi - 1)  {   bits[m++] = 64 + __builtin_ctzll(hi);   }
+
+      for (unsigned int a = 0; a < m; a++)
+      {
+        uint64_t* row = C + ((size_t) bits[a]) * n;
+        for (unsigned int b = a; b < m; b++)  {   row[bits[b]] += K;   }
+      }
+    }
+  });
+
+  Cooccurrence M = Sum_Cooccurrence(C_range, n, N);
+
+  auto end = chrono::system_clock::now();
+  Print_Cooccurrence_Info(M, end - start);
+
+  return M;
+}
+
+Cooccurrence Build_Cooccurrence(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads = 1)
+{
+  return Build_Cooccurrence_States(Nvect.size(), n, N, Nthreads, [&](uint64_t r, uint64_t* lo, uint64_t* hi, uint64_t* K)
+  {
+    (*lo) = (uint64_t) Nvect[r].first;
+    (*hi) = (uint64_t) (((unsigned __int128) Nvect[r].first) >> 64);
+    (*K) = Nvect[r].second;
+  });
+}
+
+// Dense states: the product costs about m^2/2 scattered additions per state, against n^2/16 for the n fields and
+// the C(n,2) operators of order 2 evaluated 8 rows at a time with the parity-count kernel (see 'Rows.cpp');
+// the matrix is then obtained from these values:  c_ij = (c_i + c_j - K1(s_i + s_j)) / 2.
+Cooccurrence Build_Cooccurrence_Kernel(const Rows128& Data, unsigned int Nthreads)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Co-occurrence matrix of the variables (fields and operators of order 2 evaluated with the parity-count kernel):" << endl;
+
+  unsigned int n = Data.n;
+  vector<__int128_t> Op;   // fields, then the pairs (i, j) with i < j in lexicographic order
+  for (unsigned int i = 0; i < n; i++)  {   Op.push_back(one128 << i);   }
+  for (unsigned int i = 0; i < n; i++)
+  {
+    for (unsigned int j = i + 1; j < n; j++)  {   Op.push_back((one128 << i) | (one128 << j));   }
+  }
+
+  vector<uint64_t> K1(Op.size(), 0);
+  uint64_t Nblocks = (Op.size() + Rows_batch - 1) / Rows_batch;
+  Parallel_Ranges(Nblocks, (Nthreads < 1)? 1 : Nthreads, Nblocks, [&](uint64_t, uint64_t start, uint64_t count)
+  {
+    size_t first = start * Rows_batch, last = ((start + count) * Rows_batch < Op.size())? (start + count) * Rows_batch : Op.size();
+    K1_Block(Data, Op.data() + first, last - first, K1.data() + first);
+  });
+
+  Cooccurrence M;
+  M.n = n;
+  M.N = Data.N;
+  M.C.assign(((size_t) n) * n, 0);
+
+  size_t p = n;
+  for (unsigned int i = 0; i < n; i++)  {   M.C[((size_t) i) * n + i] = K1[i];   }
+  for (unsigned int i = 0; i < n; i++)
+  {
+    for (unsigned int j = i + 1; j < n; j++, p++)
+      {   M.C[((size_t) i) * n + j] = M.C[((size_t) j) * n + i] = (K1[i] + K1[j] - K1[p]) / 2;   }
+  }
+
+  auto end = chrono::system_clock::now();
+  Print_Cooccurrence_Info(M, end - start);
+
+  return M;
+}
+
+Cooccurrence Build_Cooccurrence(const Rows128& Data, unsigned int Nthreads = 1)
+{
+  uint64_t cost_product = 0;
+  for (uint64_t r = 0; r < Data.Nrows; r++)
+  {
+    uint64_t m = __builtin_popcountll(Data.Lo[r]) + ((Data.wide)? __builtin_popcountll(Data.Hi[r]) : 0);
+    cost_product += m * (m + 1) / 2;
+  }
+  if (16 * cost_product > Data.Nrows * Data.n * Data.n)  {   return Build_Cooccurrence_Kernel(Data, Nthreads);   }
+
+  return Build_Cooccurrence_States(Data.Nrows, Data.n, Data.N, Nthreads, [&](uint64_t r, uint64_t* lo, uint64_t* hi, uint64_t* K)
+  {
+    (*lo) = Data.Lo[r];
+    (*hi) = (Data.wide)? Data.Hi[r] : 0;
+    (*K) = Data.Count[r];
+  });
+}
+
+/******************************************************************************/
+/*********************   PRINT the CO-OCCURRENCE MATRIX   *********************/
+/******************************************************************************/
+// One line per variable 'i' (bit 'i' of the states, i.e. i = 0 is the rightmost variable of the datafile):
+// the n values c_i0, c_i1, .., c_i(n-1), separated by tabs.
+void PrintFile_Cooccurrence(const Cooccurrence& M, string filename)
+{
+  string Cooc_filename = OUTPUT_directory + filename + "_Cooccurrence.dat";
+
+  cout << "-->> Print the co-occurrence matrix of the variables in the file: \'" << Cooc_filename << "\'" << endl << endl;
+
+  fstream file(Cooc_filename, ios::out);
+
+  file << "## Co-occurrence matrix:  line i, column j = number of datapoints with s_i = 1 and s_j = 1" << endl;
+  file << "##    (diagonal = number of datapoints with s_i = 1;  then K1(s_i + s_j) = c_ii + c_jj - 2*c_ij)" << endl;
+  file << "## Variable 'i' = bit 'i' of the states (i = 0 is the rightmost variable of the datafile)" << endl;
+  file << "## n = " << M.n << ", \t N = " << M.N << endl;
+  file << "## " << endl;
+
+  for (unsigned int i = 0; i < M.n; i++)
+  {
+    for (unsigned int j = 0; j < M.n; j++)  {   file << M.at(i, j) << ((j + 1 < M.n)? "\t" : "");   }
+    file << endl;
+  }
+  file.close();
+}
@@ -3,6 +3,7 @@
 #include <list>
 #include <vector>
 #include <cmath>
+#include <cstdint>
 
 using namespace std;
 
@@ -16,360 +17,213 @@ const __int128_t one128 = 1;
 //std::string int_to_bstring(__int128_t bool_nb, unsigned int n);
 //void int_to_digits(__int128_t bool_nb, unsigned int n);
 
-unsigned int min(unsigned int  a, unsigned int b)
-{
-  return !(b<a)?a:b;
-}
-
 /**************************************************************************************************************************************************/
 /************************************************************   GAUSSIAN ELIMINATION:    **********************************************************/
-/*************************************************   Return LEAD positions for basis selection   **************************************************/
+/*****************************************************   Rank, Inverse and Product over F2   ******************************************************/
 /**************************************************************************************************************************************************/
 
 /******************************************************************************/
-/**********************   Using REF on Matrix over F2   ***********************/
+/**********************   Using RREF on Matrix over F2   **********************/
 /******************************************************************************/
-void print_matrice(bool** M, int n, int m)
+void print_matrice(const MatrixF2& M)
 {
-  for (int i=0; i<n; i++)
+  for (unsigned int i=0; i<M.n; i++)
     { 
-      for (int j=0; j<m; j++)  {  cout << M[i][j]; }
+      for (unsigned int j=0; j<M.m; j++)  {  cout << M.get(i, j); }
         cout << endl;
     }
 }
 
-/********************************************************************/
-/*********    OPERATIONS for GAUSSIAN ELIMINATION on F2   ***********/
-/********************************************************************/
-void swap_row(bool** M, int i1, int i2, int n, int m)   //swap L_i1 and L_i2  in the matrix M
-{
-  if (i1>=n || i2>=n) { cout << "error swap" << endl; }
-  else {
-    bool* temp = M[i1]; //(bool*) malloc(m*sizeof(bool));
-    M[i1]=M[i2];  M[i2]=temp;
-    }
-}
+// The rows are combined by blocks of 'K_F2' rows (Method of the Four Russians):
+// the 2^K_F2 XOR combinations of the rows of a block are tabulated, with a single XOR per entry (Gray code),
+// then each row to reduce (or product to compute) needs a single table look-up per block instead of up to K_F2 row XOR.
+const unsigned int K_F2 = 8;
 
-void add_row(bool** M, int i1, int i2, int n, int m)   //L_i2 <---- L_i1 XOR L_i2
+// Table of all the XOR combinations of the 'K' rows Rows[0], ..., Rows[K-1]:   T[idx] = XOR of the rows Rows[q] with bit 'q' of 'idx' = 1
+void Table_F2(const __int128_t* Rows, unsigned int K, __int128_t* T)
 {
-  if (i1>=n || i2>=n) { cout << "error add" << endl; }
-  else {
-    for (int k = 0; k < m; k++)   {   M[i2][k] = ( M[i2][k] != M[i1][k] );   }
-    }
+  T[0] = 0;
+  for (unsigned int idx = 1; idx < (1u << K); idx++)
+    {   T[idx] = T[idx & (idx - 1)] ^ Rows[__builtin_ctz(idx)];   }
 }
 
 /********************************************************************/
-/**********************   Matrice REF:    ***************************/
-/*********   return LEAD positions for basis selection   ************/
+/**********************   Matrice RREF:    **************************/
 /********************************************************************/
-// The matrix M is put in Reduced Row Echelon Form:
-// And
-// Returns a list of the column index where there is a lead position ==>> set of independent operators starting from the left
-
-list<unsigned int> RREF_F2(bool** M, int n, int m)    // (i_lead, j_lead) = positions of the lead
+// The matrix M is put in Reduced Row Echelon Form, the lead of row 'r' being on the left of the lead of row 'r+1';
+// the same row operations are applied to M_id (if provided): starting from the identity, M_id * M_initial = M_final.
+// Returns the rank of M.
+//
+// The columns are processed by blocks of K_F2 columns:
+//   1) the leads of the block are searched row by row, the candidate rows being reduced by the leads already found in the block;
+//   2) the leads of the block are reduced between themselves, and all their combinations are tabulated;
+//   3) every other row is reduced on the lead columns of the block with a single table look-up.
+unsigned int RREF_F2(MatrixF2& M, MatrixF2* M_id = nullptr)
 {
-  int j_lead = 0;
-  int rank=0;    //rank = final number of leads
-  bool test_stop=false;
+  unsigned int rank = 0;
+  unsigned int lead_col[K_F2];
+  __int128_t T[1u << K_F2], T_id[1u << K_F2];
 
-  list<unsigned int> lead_positions;  // list of the column indices in which there is a lead position
-
-  int i=0;
+  for (unsigned int c0 = 0; c0 < M.m && rank < M.n; c0 += K_F2)
+  {
+    unsigned int r0 = rank, K = 0;  // the leads of the block are in the rows [r0, r0+K)
 
-  for (int i_lead = 0; i_lead < n  &&  j_lead < m; i_lead++)   // 
+    // 1) Search the leads of the block:
+    for (unsigned int c = c0; c < c0 + K_F2 && c < M.m && rank < M.n; c++)
     {
-      //cout << "j_lead = " << j_lead << endl;
-    i = i_lead;
-
-    //search for the 1rst non-zero element in the column
-    while (! M[i][j_lead])  // while M[i][j_lead] = 0
+      for (unsigned int i = rank; i < M.n; i++)
       {
-        //cout << "test: " << M[i][j_lead] << endl;
-      i++;
-      if (i == n)   //all elements are 0  --> no lead in this column, 1.go to the next column and 2.restart
+        for (unsigned int q = 0; q < K; q++)   // reduce row i with the leads already found in the block
         {
-        //Record No Lead positions:
-        //no_lead_positions.push_back(j_lead);
-        j_lead++;   //1. go to the next column
-          if (j_lead >= m)  { //cout << "break j_lead = " << j_lead << endl; 
-                            test_stop=true; break; }  // reduction finished
-        i = i_lead; //2. re-start the search for non-zero element from new (i_lead, j_lead)
+          if ((M.Row[i] >> lead_col[q]) & one128)
+          {
+            M.Row[i] ^= M.Row[r0+q];
+            if (M_id)  {   (*M_id).Row[i] ^= (*M_id).Row[r0+q];   }
+          }
+        }
+        if ((M.Row[i] >> c) & one128)   // new lead: move it to row 'rank'
+        {
+          swap(M.Row[i], M.Row[rank]);
+          if (M_id)  {   swap((*M_id).Row[i], (*M_id).Row[rank]);   }
+
+          for (unsigned int q = 0; q < K; q++)   // 2) remove column 'c' from the previous leads of the block
+          {
+            if ((M.Row[r0+q] >> c) & one128)
+            {
+              M.Row[r0+q] ^= M.Row[rank];
+              if (M_id)  {   (*M_id).Row[r0+q] ^= (*M_id).Row[rank];   }
+            }
+          }
+          lead_col[K] = c;  K++;  rank++;
+          break;
         }
       }
-    if(test_stop)   {  break;  }
-    //cout << "real j_lead =" << j_lead << endl;
-    //has found a non-zero element --->  1. increase rank; and 2. swap row i and row i_lead
-    rank++; 
-    if (i != i_lead)
-      { swap_row(M, i_lead, i, n, m); }
-
-    //put to zero every element under the lead (starting from i = i_lead + 1)
-    //for (i=0; i < n; i++)
-    for (i=i_lead+1; i < n; i++)
-      {
-        //if (M[i][j_lead] && i!=i_lead)
-        if (M[i][j_lead])
-          { add_row(M, i_lead, i, n, m); }  //L_i <---- L_i XOR L_i_lead
-      }
-
-    // Record lead position:
-    lead_positions.push_back(j_lead);  //cout << i << " ";
-
-    //go to the next column
-    j_lead++;
     }
+    if (K == 0)  {   continue;   }
 
-  //for (i=j_lead; i<m; i++)
-  //  {
-  //    no_lead_positions.push_back(i);  //cout << i << " ";
-  //  }
-
-  cout << "\t Final rank = " << rank << endl; 
-  return lead_positions;
-}
-
-/**************************************************************************************************************************************************/
-/**************************************************************************************************************************************************/
-/************************************************************   FIND BEST BASIS:    ***************************************************************/
-/**************************************************************************************************************************************************/
-/**************************************************************************************************************************************************/
-
-/******************************************************************************/
-/**********************   Convert  OpSet  to  F2 Matrix   *********************/
-/******************************************************************************/
-// This function returns a binary matrix that has the 'm' first operators of 'OpSet' as columns
-
-// Each Operator is a column of the matrix
-// n = Number of spins = number of rows --> 1rst index          //     !! We placed the lowest bit (most to the right) in the top row !!
-// m = Number of selected operators = number of columns --> 2nd index
-
-// This function place the 'm' first operators as column in the matrix:
-MatrixF2 OpSet_to_MatrixF2(set<Operator128> OpSet, unsigned int m, unsigned int n)
-{
-  __int128_t Op = 0;
+    // 2) Table of the combinations of the leads of the block:
+    Table_F2(M.Row.data() + r0, K, T);
+    if (M_id)  {   Table_F2((*M_id).Row.data() + r0, K, T_id);   }
 
-  // Adjust nb of columns if needed: cannot take more operators than there are in OpSet
-  m = min(m, OpSet.size());
-
-  // Create a Boolean Matrix:
-  MatrixF2 Mat(n, m);
-
-  unsigned int i = 0; //iteration over the row;
-  unsigned int j = 0; //iteration over the columns;
-
-  // Copy the m-first operators:
-  set<Operator128>::iterator it_Op = OpSet.begin();
+    // 3) Reduce all the other rows (above and below the block) on the lead columns of the block:
+    for (unsigned int i = 0; i < M.n; i++)
+    {
+      if (i == r0)  {   i = rank;   if (i >= M.n) { break; }   }   // skip the rows of the block
 
-  //cout << "Test Fill: " << endl;
+      unsigned int idx = 0;
+      for (unsigned int q = 0; q < K; q++)
+        {   idx |= ((unsigned int) ((M.Row[i] >> lead_col[q]) & one128)) << q;   }
 
-  while(j<m && it_Op != OpSet.end())
-  {
-    Op = (*it_Op).bin;
-    //cout << "\t " << j << "\t" << int_to_bstring(Op, n) << "\t"; // << endl; //<< "\t" << Op_bin
-    //int_to_digits(Op, n); 
-
-    // filling in each column:
-    for (i=0; i<n; i++)
-    { 
-      Mat.M[i][j] = Op & one128;
-      Op >>= 1;
+      M.Row[i] ^= T[idx];
+      if (M_id)  {   (*M_id).Row[i] ^= T_id[idx];   }
     }
-
-    j++; // next column
-    it_Op++;
   }
 
-  Mat.OpSet_offset = j; // Number of operators analysed so far
-
-  //cout << "Next Operator: " << endl;
-  //Op = (*it_Op).bin;
-  //cout << "\t " << j << "\t" << int_to_bstring(Op, n) << "\t"; // << endl; //<< "\t" << Op_bin
-  //int_to_digits(Op, n); 
-
-  return Mat;
+  return rank;
 }
 
-/******************************************************************************/
-/**********************   Convert  OpSet  to  F2 Matrix   *********************/
-/*********************************   REFILL   *********************************/
-/******************************************************************************/
-void OpSet_to_MatrixF2_Refill(MatrixF2 *Mat, vector<Operator128> BestBasis, set<Operator128> OpSet, unsigned int m)
-// Reminder: Each Operator is a column of the matrix
-// m = Number of selected operators = number of columns --> 2nd index
-// n = Number of spins = number of rows --> 1rst index
-// !! We placed the lowest bit (most to the right) in the top row !!
+/********************************************************************/
+/**********************   Product over F2:    ***********************/
+/********************************************************************/
+// Returns the product C = A * B, with  A.m = B.n:   row 'i' of C = XOR of the rows 'j' of B for which A(i, j) = 1.
+// The rows of B are tabulated by blocks of K_F2 rows: one table look-up per block for each row of A.
+MatrixF2 Product_F2(const MatrixF2& A, const MatrixF2& B)
 {
-  __int128_t Op_bin = 0;
-
-  unsigned int i = 0; //iteration over the row;s
-  unsigned int j = 0; //iteration over the columns;
-
-  unsigned int n = (*Mat).n;   //total number of rows;
-
-//  cout << "Test Refill -- First: " << endl; 
+  MatrixF2 C(A.n, B.m);
+  vector<__int128_t> T(1u << K_F2);
 
-// Refill the lead Operators to the left of the Matrix 'M':
-  for (auto& it_Op : BestBasis) 
+  for (unsigned int j0 = 0; j0 < B.n; j0 += K_F2)
   {
-    Op_bin = it_Op.bin;
-    //cout << "\t " << j << "\t" << int_to_bstring(Op_bin, n) << "\t";  //<< "\t" << Op_bin
-    //int_to_digits(Op_bin, n);
+    unsigned int K = ((B.n - j0) < K_F2)? (B.n - j0) : K_F2;
+    Table_F2(B.Row.data() + j0, K, T.data());
 
-    // filling in each column:
-    for (i=0; i<n; i++)
-    { 
-      (*Mat).M[i][j] = Op_bin & one128;
-      Op_bin >>= 1;
-    }
-    j++; // next column
+    for (unsigned int i = 0; i < A.n; i++)
+      {   C.Row[i] ^= T[(unsigned int) ((A.Row[i] >> j0) & ((one128 << K) - 1))];   }
   }
 
-// Fill M with the next operators from OpSet, until there is m operators in M or until OpSet is empty
-  set<Operator128>::iterator it_Op = OpSet.begin();
-  advance(it_Op, (*Mat).OpSet_offset);
-
-  //cout << "Test Refill -- Second: " << endl; 
-
-  while(j<m && it_Op != OpSet.end())
-  {
-    Op_bin = (*it_Op).bin;
-    //cout << "\t " << j << "\t" << int_to_bstring(Op_bin, n) << "\t";  //<< "\t" << Op_bin
-    //int_to_digits(Op_bin, n);  
-
-    // filling in each column:
-    for (i=0; i<n; i++)
-    { 
-      (*Mat).M[i][j] = Op_bin & one128;
-      Op_bin >>= 1;
-    }
-
-    j++; // next column
-    it_Op++;
-  }
-  (*Mat).m = j;
-  (*Mat).OpSet_offset += j - BestBasis.size();
-
-// Fill rest of M with zeros if needed
-  while(j<m)
-  {
-    for (i=0; i<n; i++)
-      {   (*Mat).M[i][j] = 0;  }
-    j++;
-  }
+  return C;
 }
 
+/**************************************************************************************************************************************************/
+/**************************************************************************************************************************************************/
+/************************************************************   FIND BEST BASIS:    ***************************************************************/
+/**************************************************************************************************************************************************/
+/**************************************************************************************************************************************************/
 
-/********************************************************************/
-/******************    Print Terminal list lead   *******************/
-/********************************************************************/
-void PrintTerm_listLeads(list<unsigned int> lead_positions)
+/******************************************************************************/
+/******************   Add an Operator to an Echelon Basis   *******************/
+/******************************************************************************/
+// Position of the highest bit of 'Op' (Op != 0):
+inline unsigned int highest_bit(__int128_t Op)
 {
-  for (auto& it_lead : lead_positions)
-    {   cout << it_lead << endl;   }
-  cout << endl;
+  uint64_t hi = (uint64_t) (((unsigned __int128) Op) >> 64), lo = (uint64_t) Op;
+  return (hi)? (127 - __builtin_clzll(hi)) : (63 - __builtin_clzll(lo));
 }
 
-/********************************************************************/
-/******************    Extract Lead Operators    ********************/
-/********************************************************************/
-void Extract_LeadOp(set<Operator128> OpSet, unsigned int n, list<unsigned int> lead_positions, Struct_LowerBound* LowerBound, vector<Operator128>& BestBasis, unsigned int offset=0)
+// Reduce 'Op' with the pivots of 'E' (at most 'rank' XOR):
+// returns 'true' and adds the residue as a new pivot if 'Op' is independent of the operators of 'E'; returns 'false' otherwise.
+bool Add_Echelon(Echelon_Basis& E, __int128_t Op)
 {
-  //cout << "-->> Extract Leads" << endl;
-
-// Current Basis size:  --> elements already saved
-  unsigned int r = BestBasis.size();
-
-// Skip the first 'r' leads that were already filled in:
-  auto it_lead = lead_positions.begin();
-  advance(it_lead, r);
-  unsigned int lead_index = r;    // index of the last already extracted lead (this would be '0' if the current basis is empty)
-
-// Skip the operators that were previously analyzed with 'offset': 
-  auto it_Op = OpSet.begin();
-  advance(it_Op, offset);  
-
-// Extract the first next operators using lead_positions with offset: 
-  while(it_lead != lead_positions.end())
+  unsigned int i = 0;
+  while (Op)
   {
-    advance(it_Op, (*it_lead)-lead_index);
-    BestBasis.push_back(*it_Op);
-    lead_index = (*it_lead);
-    
-    //cout << (*it_lead) << "\t" << int_to_bstring((*it_Op).bin, n) << "\t" << (*it_Op).bias << "\t Indices = "; //<< endl;
-    //int_to_digits((*it_Op).bin, n);
-    it_lead++;
+    i = highest_bit(Op);
+    if (!E.Pivot[i])
+    {
+      E.Pivot[i] = Op;
+      E.rank++;
+      return true;
+    }
+    Op ^= E.Pivot[i];
   }
-
-// Record information on the bias of the last basis operators:
-  it_lead--;
-  (*LowerBound).Bias = (*it_Op).bias;
-  (*LowerBound).Index = offset + (*it_lead)-r;
-
-  //cout << endl;
-
-// Check that the size of the basis is the same as the size of the list of leads:
-  if(BestBasis.size() != lead_positions.size())
-    { cout << "Error in function 'Extract_LeadOp':   BestBasis.size() != lead_positions.size()" << endl << endl;}
-  //cout << endl;
+  return false;
 }
 
-
 /********************************************************************/
-/******************   Find Best Basis REF:    ***********************/
+/******************   Find Best Basis:    ***************************/
 /********************************************************************/
-/***********    Run multiple times lead search until     ************/
-/**********   n independent operators have been found     ***********/
+/********    Greedy: go through the operators from the most    ******/
+/********    to the least biased, and keep each operator that   ******/
+/**********    is independent from the ones already kept;    ********/
+/**********    stop when n independent operators are kept    ********/
 /***************      or  the OpSet is empty      *******************/
 /********************************************************************/
-
-/// Important: 'm' must be larger than the number of variables 'n' to find a basis;
-///            For 'm < n', the function will look for the m first independent operators
-
-vector<Operator128> BestBasis_inOpSet(set<Operator128> OpSet, unsigned int n, Struct_LowerBound* LowerBound, unsigned int m=1000) 
+// 'Skip_Op(Op)' returns true for the operators that are already known to depend on the previous ones (they are not reduced).
+// LowerBound is over-written with the bias and the index in OpSet of the last operator of the basis.
+template <typename SkipFunction>
+vector<Operator128> BestBasis_inOpSet_Greedy(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound, SkipFunction Skip_Op)
 {
   vector<Operator128> BestBasis;
-
-// ***** Initial search for best basis: ******************************
-  MatrixF2 Mat = OpSet_to_MatrixF2(OpSet, m, n);
+  Echelon_Basis E;
 
   cout << "Total number of Operators to analyse = " << OpSet.size() << endl << endl;
-  cout << "-->> Search for the Best Basis by step of 'm' = " << Mat.m << " most biased operators:" << endl;
-
-  cout << "\t Nit = " << 0 << ": \t";
-  list<unsigned int> list_lead = RREF_F2(Mat.M, Mat.n, Mat.m);
+  cout << "-->> Greedy search for the Best Basis, from the most biased operator:" << endl;
 
-  if (list_lead.size() > 0)
-    {  Extract_LeadOp(OpSet, n, list_lead, LowerBound, BestBasis); }
+  unsigned int Nreduced = 0;   // number of operators reduced
+  Operator128 Op;
 
-// ***** Refill and search for best basis: ****************************
-  unsigned int Nit = 1;                      // Iteration index (starting from 1)
-  unsigned int offset = Mat.OpSet_offset;    // Number of operators already analysed in OpSet
-
-  while( (offset < OpSet.size()) && BestBasis.size()<n && BestBasis.size()<m )
+  for (size_t index = 0; index < OpSet.size() && BestBasis.size() < n; index++)   // index of the current operator in OpSet
   {
-    cout << "\t Nit = " << Nit << ": \t"; // "current Basis Size = " << BestBasis.size() << endl;
-   
-    OpSet_to_MatrixF2_Refill(&Mat, BestBasis, OpSet, m);
-    list_lead = RREF_F2(Mat.M, Mat.n, Mat.m);
-
-    if (list_lead.size() > BestBasis.size())
-      {  Extract_LeadOp(OpSet, n, list_lead, LowerBound, BestBasis, offset); }
+    Op = OpSet.at(index);
+    if (Skip_Op(Op))  {   continue;   }
 
-
-    offset = Mat.OpSet_offset; // New offset
-    Nit++;
+    Nreduced++;
+    if (Add_Echelon(E, Op.bin))
+    {
+      BestBasis.push_back(Op);
+      (*LowerBound).Bias = Op.bias;
+      (*LowerBound).Index = index;
+    }
   }
+
+  cout << "\t Number of operators reduced = " << Nreduced << ", \t Final rank = " << E.rank << endl; 
   cout << endl << "-->> The Final Basis found has " << BestBasis.size() << " independent operators:" << endl;
 
   if(BestBasis.size()==n) {
     cout << "\t --> this is equal to the number \'n\' of variables: i.e., this is a Basis for the n-dimensional system" << endl;
   }
-  else if(m<n && BestBasis.size() == m) {
-    cout << "\t --> this is equal to the number 'm' = " << m << " provided for the analysis (which is smaller than the number of variables 'n' = " << n << ");" << endl;
-    cout << "\t\t the Basis has the largest number of elements for an m-dimensional system." << endl;
-  }
   else {
-    cout << "\t --> The basis found has a dimension smaller than the dimension of the system analysed (< n and < m)" << endl;
+    cout << "\t --> The basis found has a dimension smaller than the dimension of the system analysed (< n)" << endl;
   }
   cout << "\t --> Smallest Bias among the basis components = " << (*LowerBound).Bias << endl;
   cout << endl;
@@ -377,6 +231,28 @@ vector<Operator128> BestBasis_inOpSet(set<Operator128> OpSet, unsigned int n, St
   return BestBasis;
 }
 
+vector<Operator128> BestBasis_inOpSet(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound)
+{
+  return BestBasis_inOpSet_Greedy(OpSet, n, LowerBound, [](const Operator128&) {   return false;   });
+}
+
+/********************************************************************/
+/**********   Find Best Basis, knowing the previous Basis   *********/
+/********************************************************************/
+// 'OpSet' contains the operators of order < k already analysed at the previous step, which gave the basis 'BestBasis_previous',
+// and the new operators of order k.
+// The greedy search keeps, at each step, a basis of all the operators seen so far:
+// an old operator that was not in 'BestBasis_previous' depends on the more biased old operators, and is therefore skipped;
+// only the new operators and the operators of 'BestBasis_previous' are reduced. The basis found is the same as with 'BestBasis_inOpSet'.
+vector<Operator128> BestBasis_inOpSet(const OpSet128& OpSet, unsigned int n, Struct_LowerBound* LowerBound, const vector<Operator128>& BestBasis_previous, unsigned int k)
+{
+  set<__int128_t> Basis_previous;
+  for (auto& Op : BestBasis_previous)  {   Basis_previous.insert(Op.bin);   }
+
+  return BestBasis_inOpSet_Greedy(OpSet, n, LowerBound, [&](const Operator128& Op) 
+    {   return bitset_count(Op.bin) < k && Basis_previous.find(Op.bin) == Basis_previous.end();   });
+}
+
 
 
 /**************************************************************************************************************************************************/
@@ -386,106 +262,14 @@ vector<Operator128> BestBasis_inOpSet(set<Operator128> OpSet, unsigned int n, St
 /**************************************************************************************************************************************************/
 
 /********************************************************************/
-/**********************   Matrice REF:    ***************************/
+/**********************   Matrice Inverse:    ***********************/
 /********************************************************************/
-// The matrix M is put in Reduced Row Echelon Form
-// And
-// Returns the inverse of M
-
-pair<int, bool**> RREF_F2_invert(bool** M, int n)    // (i_lead, j_lead) = positions of the lead
+// Returns the rank of the square matrix M; if it is invertible (rank = n), M_inv is over-written with the inverse of M.
+unsigned int Invert_F2(MatrixF2 M, MatrixF2& M_inv)
 {
-  //cout << "Initial matrix:  " << endl;
-  //print_matrice(M, n, n);
-  //cout << endl;
-
-  // Create a Identity Matrix:
-  bool** M_id = (bool**) malloc(n*sizeof(bool*));  // n rows --> 1rst index
-  for (int i=0; i<n; i++)  // n columns --> 2nd index
-  {   
-    M_id[i] = (bool*) malloc(n * sizeof(bool));  
-    for (int j=0; j<n; j++)  // n columns --> 2nd index
-    {
-      M_id[i][j] = 0;
-    } 
-    M_id[i][i] = 1;
-  }
-
-//  cout << "Identity matrix:  " << endl;
-//  print_matrice(M_id, n, n);
-
-  // Reduction:
-  int j_lead = 0;
-  int rank=0;    //rank = final number of leads
-  bool test_stop=false;
-
-  //list<unsigned int> lead_positions;  // list of the column indices in which there is a lead position
-
-  int i=0;
-
-  for (int i_lead = 0; i_lead < n  &&  j_lead < n; i_lead++)   // 
-  {
-    //cout << "j_lead = " << j_lead << endl;
-    i = i_lead;
-
-    //search for the 1rst non-zero element in the column
-    while (! M[i][j_lead])  // while M[i][j_lead] = 0
-    {
-        //cout << "test: " << M[i][j_lead] << endl;
-      i++;
-      if (i == n)   //all elements are 0  --> no lead in this column, 1.go to the next column and 2.restart
-      {
-        j_lead++;   //1. go to the next column
-        if (j_lead >= n)  
-        { 
-          test_stop=true; break; 
-        }  // reduction finished
-        i = i_lead; //2. re-start the search for non-zero element from new (i_lead, j_lead)
-      }
-    }
-    if(test_stop)   {  break;  }
-    //cout << "real j_lead =" << j_lead << endl;
-
-    //has found a non-zero element --->  1. increase rank; and 2. swap row i and row i_lead
-    rank++; 
-    if (i != i_lead)
-    { 
-      //cout << "i_lead = " << i_lead << " and i = " << i << ": swap rows:" << endl;
-      swap_row(M, i_lead, i, n, n); 
-      swap_row(M_id, i_lead, i, n, n); 
-      //print_matrice(M_id, n, n);
-      //cout << endl;
-    }
-
-    //put to zero all the element with i != i_lead
-    for (i=0; i < n; i++)
-    {
-      if (M[i][j_lead] && i!=i_lead)  //L_i <---- L_i XOR L_i_lead
-      { 
-        add_row(M, i_lead, i, n, n); 
-        add_row(M_id, i_lead, i, n, n); 
-
-        //cout << "Add row: i_lead = " << i_lead << " and i = " << i << " into i" << endl;
-        //print_matrice(M_id, n, n);
-        //cout << endl;
-      }
-    }
-
-    // Record lead position:
-    //lead_positions.push_back(j_lead);  //cout << i << " ";
+  M_inv = MatrixF2(M.n, M.n);
+  for (unsigned int i = 0; i < M.n; i++)
+    {   M_inv.Row[i] = one128 << i;   }   // identity
 
-    //go to the next column
-    j_lead++;
-  }
-
-  //for (i=j_lead; i<m; i++)
-  //  {
-  //    no_lead_positions.push_back(i);  //cout << i << " ";
-  //  }   
-
-  return make_pair(rank, M_id);
+  return RREF_F2(M, &M_inv);
 }
-
-
-
-
-
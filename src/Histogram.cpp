@@ -0,0 +1,176 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+/******************************************************************************/
+/**************************   HASH TABLE of the STATES   **********************/
+/******************************************************************************/
+// Double the table (1024 slots at the beginning), and insert again all the states:
+void Histogram128::grow()
+{
+  vector<pair<__int128_t, uint64_t>> Old(Slot.empty()? 1024 : 2 * Slot.size(), pair<__int128_t, uint64_t>(0, 0));
+  Old.swap(Slot);
+
+  shift = 64;
+  for (size_t size = Slot.size(); size > 1; size >>= 1)  {   shift--;   }
+
+  Nentries = 0;
+  for (auto& it : Old)
+    {   if (it.second)  {   add(it.first, it.second);   }   }
+}
+
+// All the states of the table, by increasing value of the state:
+void Sort_States(vector<pair<__int128_t, uint64_t>>& A);
+
+vector<pair<__int128_t, uint64_t>> Histogram_toVect(const Histogram128& Histo)
+{
+  vector<pair<__int128_t, uint64_t>> Nvect;
+  Nvect.reserve(Histo.Nentries);
+
+  for (auto& it : Histo.Slot)
+    {   if (it.second)  {   Nvect.push_back(it);   }   }
+
+  Sort_States(Nvect);
+  return Nvect;
+}
+
+// Merge all the tables in the first one (the other tables are freed), and return its states by increasing value of the state:
+vector<pair<__int128_t, uint64_t>> Merge_Histograms(vector<Histogram128>& Histo)
+{
+  if (Histo.empty())  {   return vector<pair<__int128_t, uint64_t>>();   }
+
+  for (size_t r = 1; r < Histo.size(); r++)
+  {
+    for (auto& it : Histo[r].Slot)
+      {   if (it.second)  {   Histo[0].add(it.first, it.second);   }   }
+    vector<pair<__int128_t, uint64_t>>().swap(Histo[r].Slot);
+  }
+  return Histogram_toVect(Histo[0]);
+}
+
+/******************************************************************************/
+/*************************   RADIX SORT of the STATES   ***********************/
+/******************************************************************************/
+// LSD radix sort of the pairs (state, count) by increasing value of the state (same order as 'std::map<__int128_t, ..>'),
+// with one pass per byte of the states;  the bytes that are the same for all the states are skipped.
+// The sign bit is flipped, so that the unsigned order of the bytes is the signed order of the states.
+inline unsigned __int128 Radix_Key(__int128_t state)
+  {   return ((unsigned __int128) state) ^ (((unsigned __int128) 1) << 127);   }
+
+void Sort_States(vector<pair<__int128_t, uint64_t>>& A)
+{
+  if (A.size() < 2)  {   return;   }
+
+  unsigned __int128 bits_or = 0, bits_and = ~((unsigned __int128) 0);
+  for (auto& it : A)  {   bits_or |= Radix_Key(it.first);   bits_and &= Radix_Key(it.first);   }
+  unsigned __int128 varying = bits_or ^ bits_and;   // bits that are not the same for all the states
+
+  vector<pair<__int128_t, uint64_t>> Tmp(A.size());
+  size_t count[256];
+
+  for (unsigned int b = 0; b < 16; b++)
+  {
+    if (((varying >> (8*b)) & 0xFF) == 0)  {   continue;   }
+
+    fill(count, count + 256, 0);
+    for (auto& it : A)  {   count[(unsigned int) ((Radix_Key(it.first) >> (8*b)) & 0xFF)]++;   }
+
+    size_t pos = 0, c = 0;
+    for (unsigned int v = 0; v < 256; v++)  {   c = count[v];  count[v] = pos;  pos += c;   }
+
+    for (auto& it : A)  {   Tmp[count[(unsigned int) ((Radix_Key(it.first) >> (8*b)) & 0xFF)]++] = it;   }
+    A.swap(Tmp);
+  }
+}
+
+// Sorted pairs: add the counts of the successive pairs with the same state
+void RunLength_States(vector<pair<__int128_t, uint64_t>>& A)
+{
+  size_t j = 0;
+  for (size_t i = 0; i < A.size(); i++)
+  {
+    if (j > 0 && A[j-1].first == A[i].first)  {   A[j-1].second += A[i].second;   }
+    else  {   A[j++] = A[i];   }
+  }
+  A.resize(j);
+}
+
+// Sorted lists of pairs, without repeated states: merged two by two (in parallel), with their run-length;
+// the lists are freed, and the merged list is returned.
+vector<pair<__int128_t, uint64_t>> Merge_Sorted_States(vector<vector<pair<__int128_t, uint64_t>>>& Sorted, unsigned int Nthreads = 1)
+{
+  if (Sorted.empty())  {   return vector<pair<__int128_t, uint64_t>>();   }
+
+  auto less_state = [](const pair<__int128_t, uint64_t>& a, const pair<__int128_t, uint64_t>& b)
+    {   return a.first < b.first;   };
+
+  for (size_t step = 1; step < Sorted.size(); step *= 2)
+  {
+    uint64_t Nmerge = (Sorted.size() + 2*step - 1) / (2*step);
+    Parallel_Ranges(Nmerge, Nthreads, Nmerge, [&](uint64_t, uint64_t start, uint64_t)
+    {
+      size_t i = start * 2 * step, j = i + step;
+      if (j >= Sorted.size())  {   return;   }
+
+      vector<pair<__int128_t, uint64_t>> M(Sorted[i].size() + Sorted[j].size());
+      merge(Sorted[i].begin(), Sorted[i].end(), Sorted[j].begin(), Sorted[j].end(), M.begin(), less_state);
+      RunLength_States(M);
+      Sorted[i].swap(M);
+      vector<pair<__int128_t, uint64_t>>().swap(Sorted[j]);
+    });
+  }
+
+  vector<pair<__int128_t, uint64_t>> Merged;
+  Merged.swap(Sorted[0]);
+  return Merged;
+}
+
+/******************************************************************************/
+/*******************   HISTOGRAM of a LIST of STATES   ************************/
+/******************************************************************************/
+// Number of different states below which the histogram is built with hash tables (that stay in cache), and with a sort above:
+const size_t Histo_hash_max = 1 << 20;
+
+// Histogram of the pairs (state, count), given by 'Pair(i)' for i = 0, .., Npairs-1 (computed in parallel over 'Nthreads' threads):
+//   -- hash:  one hash table per range of pairs, then merged in a single table;
+//   -- sort:  the pairs are radix-sorted by range, then merged two by two, with their run-length (same state --> counts are added).
+// The histogram is returned by increasing value of the state;  it doesn't depend on the method or on the number of threads.
+vector<pair<__int128_t, uint64_t>> Build_Histogram(size_t Npairs, unsigned int Nthreads, const function<pair<__int128_t, uint64_t>(size_t)>& Pair)
+{
+  if (Nthreads < 1)  {   Nthreads = 1;   }
+  uint64_t Nranges = Nthreads;
+
+  if (Npairs <= Histo_hash_max)
+  {
+    vector<Histogram128> Histo_range(Nranges);
+    Parallel_Ranges(Npairs, Nthreads, Nranges, [&](uint64_t range, uint64_t start, uint64_t count)
+    {
+      for (uint64_t i = start; i < start + count; i++)
+        {   pair<__int128_t, uint64_t> P = Pair(i);   Histo_range[range].add(P.first, P.second);   }
+    });
+
+    return Merge_Histograms(Histo_range);
+  }
+
+  vector<vector<pair<__int128_t, uint64_t>>> Sorted(Nranges);
+  Parallel_Ranges(Npairs, Nthreads, Nranges, [&](uint64_t range, uint64_t start, uint64_t count)
+  {
+    Sorted[range].resize(count);
+    for (uint64_t i = 0; i < count; i++)  {   Sorted[range][i] = Pair(start + i);   }
+    Sort_States(Sorted[range]);
+    RunLength_States(Sorted[range]);
+  });
+
+  return Merge_Sorted_States(Sorted, Nthreads);
+}
@@ -4,6 +4,7 @@
 #include <set>
 #include <vector>
 #include <fstream>
+#include <functional>
 
 #include <ctime> // for chrono
 #include <ratio> // for chrono
@@ -27,23 +28,41 @@ void int_to_digits_file(__int128_t bool_nb, unsigned int r, fstream &file);
 //double min_double(double a, double b)
 //{  return !(b<a)?a:b;   }
 
-unsigned int Choose(unsigned int n, unsigned int k);
+uint64_t Choose(unsigned int n, unsigned int k);
+
+void Unrank_Combination(uint64_t rank, unsigned int n, unsigned int k, unsigned int* idx);
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+Candidate128 Make_Candidate(__int128_t Op_bin, uint64_t k1);
+void Add_toOpSet(OpSet128& OpSet, vector<Candidate128>& Batch);
+void Add_toOpSet(OpSet128& OpSet, vector<vector<Candidate128>>& Batches, unsigned int Nthreads = 1);
+
+void Init_Floor(Struct_Floor& Floor, const OpSet128& OpSet, unsigned int n);
+size_t Raise_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer);
+void Check_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer, Floor_Check& Check);
+void Cut_Floor(OpSet128& OpSet, Struct_Floor& Floor);
+
+size_t Cache_Room(const Cache_R0& Cache);
+void Cache_Insert(Cache_R0& Cache, vector<vector<Candidate128>>& Missed);
 
 /******************************************************************************/
 /************************   Print Terminal Operators  *************************/
 /******************************************************************************/
-void PrintTerm_OpSet(set<Operator128> OpSet, unsigned int n)
+void PrintTerm_OpSet(const OpSet128& OpSet, unsigned int n)
 {
   cout << "--> Print Set of Operators: \t Total number of operators = " << OpSet.size() << endl << endl;  
 
-  for (auto& Op : OpSet)
+  Operator128 Op;
+  for (size_t i = 0; i < OpSet.size(); i++)
   {
+    Op = OpSet.at(i);
     cout <<  int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t"; // << endl;
     int_to_digits(Op.bin, n);
   }
 }
 
-void PrintFile_OpSet(set<Operator128> OpSet, unsigned int n, string filename)
+void PrintFile_OpSet(const OpSet128& OpSet, unsigned int n, string filename)
 {
   string OpSet_filename = OUTPUT_directory + filename + "_OpSet.dat";
 
@@ -53,8 +72,10 @@ void PrintFile_OpSet(set<Operator128> OpSet, unsigned int n, string filename)
 
   file_OpSet << "--> Print Set of Operators: \t Total number of operators = " << OpSet.size() << endl << endl;  
 
-  for (auto& Op : OpSet)
+  Operator128 Op;
+  for (size_t i = 0; i < OpSet.size(); i++)
   {
+    Op = OpSet.at(i);
     file_OpSet <<  int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t"; //<< endl;
     int_to_digits_file(Op.bin, n, file_OpSet);
   }
@@ -65,18 +86,21 @@ void PrintFile_OpSet(set<Operator128> OpSet, unsigned int n, string filename)
 /********************     AVERAGES and OBSERVABLES   **************************/
 /******************************************************************************/
 // Number of times an operator is equal to 1 ( = <phi> in the {0,1} representation ) in the dataset
-unsigned int K1_Op(vector<pair<__int128_t, unsigned int>> Nvect, __int128_t Op)  // Complexity = O(|Nset|)
+uint64_t K1_Op(const vector<pair<__int128_t, uint64_t>>& Nvect, __int128_t Op)  // Complexity = O(|Nset|)
 {
-  unsigned int K1=0;
+  uint64_t K1=0;
 
   for (auto& it : Nvect)
-    {    K1 += (bitset_count( ((it).first) & Op ) % 2)*((it).second);   } 
+  {
+    __int128_t x = (it.first) & Op;
+    K1 += (__builtin_parityll(((uint64_t) x) ^ ((uint64_t) (((unsigned __int128) x) >> 64))))*((it).second);
+  }
 
   return K1;
 }
 
 // ******* Data averages are taken using ISING convention: ******************** / 
-Operator128 Value_Op(__int128_t Op_bin, vector<pair<__int128_t, unsigned int>> Nvect, double Nd)
+Operator128 Value_Op(__int128_t Op_bin, const vector<pair<__int128_t, uint64_t>>& Nvect, double Nd)
 {
   Operator128 Op;
 
@@ -92,16 +116,53 @@ Operator128 Value_Op(__int128_t Op_bin, vector<pair<__int128_t, unsigned int>> N
   return Op;
 }
 
+// Values K1 of a block of 'B' operators Op[0, B), with one pass over the data by tiles of 'Rows_tile' states:
+void K1_Block(const vector<pair<__int128_t, uint64_t>>& Nvect, const __int128_t* Op, size_t B, uint64_t* K1)
+{
+  for (size_t b = 0; b < B; b++)  {   K1[b] = 0;   }
+
+  for (size_t r_start = 0; r_start < Nvect.size(); r_start += Rows_tile)
+  {
+    size_t r_end = (r_start + Rows_tile < Nvect.size())? r_start + Rows_tile : Nvect.size();
+    for (size_t b = 0; b < B; b++)
+    {
+      for (size_t r = r_start; r < r_end; r++)
+      {
+        __int128_t x = Nvect[r].first & Op[b];
+        K1[b] += (__builtin_parityll(((uint64_t) x) ^ ((uint64_t) (((unsigned __int128) x) >> 64))))*(Nvect[r].second);
+      }
+    }
+  }
+}
+
+// ******* Same, on the row-major copy of the data (see 'Rows.cpp'): ************ /
+uint64_t K1_Op(const Rows128& Data, __int128_t Op);
+void K1_Block(const Rows128& Data, const __int128_t* Op, size_t B, uint64_t* K1);
+Operator128 Value_Op(__int128_t Op_bin, const Rows128& Data, double Nd);
+
+// ******* Same, on the bit-sliced data (see 'BitSliced.cpp'): ****************** /
+Operator128 Value_Op(__int128_t Op_bin, const BitSliced& Data, double Nd);
+
+// ******* Same, on the sparse columns of the data (see 'Sparse.cpp'): ********** /
+Operator128 Value_Op(__int128_t Op_bin, const SparseColumns& Data, double Nd);
+
+// ******* Same, from the Walsh-Hadamard spectrum of the data (see 'WalshHadamard.cpp'): ****** /
+Operator128 Value_Op(__int128_t Op_bin, const Spectrum& Data, double Nd);
+
 /******************************************************************************/
 /***********************   All Operators with 1 bit only  *********************/
 /************************   Find the lowest bias value  ***********************/
 /******************************************************************************/
 // this value will serve as a lower bound for operators that we will keep later on.
-set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, double *lowest_bias, bool print = false)
+// 'Data' is either the histogram 'Nvect', its row-major copy, the bit-sliced data, its sparse columns or the Walsh-Hadamard spectrum: the operators are evaluated with the corresponding 'Value_Op'
+template <typename DataType>
+OpSet128 All_Op_k1_Data(const DataType& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print)
 {
   auto start = chrono::system_clock::now();
 
-  set<Operator128> OpSet;
+  OpSet128 OpSet;
+  OpSet.N = N;
+  vector<Candidate128> Fields;
   Operator128 Op;
 
   double Nd = (double) N;
@@ -112,8 +173,8 @@ set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigne
   __int128_t one_i = 1;
   for (int i=0; i<n; i++) // All Fields:
   { 
-    Op = Value_Op(one_i, Nvect, Nd);
-    OpSet.insert(Op);
+    Op = Value_Op(one_i, Data, Nd);
+    Fields.push_back(Make_Candidate(Op.bin, Op.k1));
     //if (Op.bias < (*lowest_bias)) { (*lowest_bias) = Op.bias; }
     if(print)
     { 
@@ -125,13 +186,16 @@ set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigne
 
   cout << endl;
 
-  cout << "Smallest bias = " << (*OpSet.rbegin()).bias << ", \t for the operator = " << int_to_bstring((*OpSet.rbegin()).bin, n) << "\t";
-  int_to_digits((*OpSet.rbegin()).bin, n);
-  cout << " Largest bias = " << (*OpSet.begin()).bias << ", \t for the operator = " << int_to_bstring((*OpSet.begin()).bin, n) << "\t";
-  int_to_digits((*OpSet.begin()).bin, n);
+  Add_toOpSet(OpSet, Fields);
+  Operator128 Op_min = OpSet.at(OpSet.size()-1), Op_max = OpSet.at(0);
+
+  cout << "Smallest bias = " << Op_min.bias << ", \t for the operator = " << int_to_bstring(Op_min.bin, n) << "\t";
+  int_to_digits(Op_min.bin, n);
+  cout << " Largest bias = " << Op_max.bias << ", \t for the operator = " << int_to_bstring(Op_max.bin, n) << "\t";
+  int_to_digits(Op_max.bin, n);
   cout << endl;
 
-  (*lowest_bias) = (*OpSet.rbegin()).bias;
+  (*lowest_bias) = Op_min.bias;
 
 // Compare with 3*sigma bound:
   double sigma3_bound = 3 * 0.5 / sqrt(Nd);
@@ -155,95 +219,252 @@ set<Operator128> All_Op_k1(vector<pair<__int128_t, unsigned int>> Nvect, unsigne
   return OpSet;
 }
 
+OpSet128 All_Op_k1(vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, double *lowest_bias, bool print = false)
+{
+  return All_Op_k1_Data(Nvect, n, N, lowest_bias, print);
+}
+
+OpSet128 All_Op_k1(const Rows128& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false)
+{
+  return All_Op_k1_Data(Data, n, N, lowest_bias, print);
+}
+
+OpSet128 All_Op_k1(const BitSliced& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false)
+{
+  return All_Op_k1_Data(Data, n, N, lowest_bias, print);
+}
+
+OpSet128 All_Op_k1(const SparseColumns& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false)
+{
+  return All_Op_k1_Data(Data, n, N, lowest_bias, print);
+}
+
+OpSet128 All_Op_k1(const Spectrum& Data, unsigned int n, uint64_t N, double *lowest_bias, bool print = false)
+{
+  return All_Op_k1_Data(Data, n, N, lowest_bias, print);
+}
+
 /******************************************************************************/
-/*************************   All Integers with k-bits   ***********************/
+/*******************   Evaluate all Operators with k bits  ********************/
+/*****************   in parallel, over ranges of combinations  ****************/
 /******************************************************************************/
-bool Incr_k_bits(unsigned int k, __int128_t *a, unsigned int n)  //only for (k <= n)
+// The C(n,k) combinations of k variables are split in ranges of successive ranks (lexicographic order),
+// shared between 'Opt.threads' threads;  'Eval_Range(Buffer, start, count)' evaluates the 'count' operators starting
+// from the rank 'start', and stores the accepted ones in the buffer 'Buffer' of its range.
+// The buffers are then sorted and merged in OpSet: the result doesn't depend on the number of threads.
+// With a cache of the values in R0 (Cache != nullptr), the values that were not in the cache are recorded by each range
+// in 'Missed', and added to the cache at the end.
+// At the end of each range, its buffer is added to the seed of the floor (see 'Raise_Floor' in 'OpSet.cpp'), so that the
+// ranges evaluated next start from the operators found in all the previous ones.
+// Returns the number of operators evaluated
+uint64_t AllOp_kbits_Parallel(OpSet128& OpSet, unsigned int n, unsigned int k, bool print, Struct_Options Opt, Struct_Floor& Floor, Cache_R0* Cache, const function<void(vector<Candidate128>&, vector<Candidate128>&, uint64_t, uint64_t)>& Eval_Range)
 {
-    __int128_t c = 1, c_stop = 1;
+  uint64_t total = Choose(n, k);
+  unsigned int Nthreads = (print || Opt.threads < 1)? 1 : Opt.threads;   // operators can only be printed with one thread
+  uint64_t Nranges = (Nthreads == 1)? 1 : 64 * ((uint64_t) Nthreads);
 
-// Find position of the lowest bit:
-    c = (((*a) - 1) ^ (*a)) & (*a);
+  if (Nranges > total)  {   Nranges = total;   }
+  if (Nthreads > 1)
+    {   cout << "\t Number of threads = " << Nthreads << ", \t Number of ranges of combinations = " << Nranges << endl;   }
 
-// Increament "a" by 1 starting from the lowest bit:
-    *a = *a + c;
+  vector<vector<Candidate128>> Buffers(Nranges);
+  vector<vector<Candidate128>> Missed(Nranges);
+  if (Cache)  {   Cache->room_per_range = Cache_Room(*Cache) / Nranges;   }
 
-// Fill with 1's, starting from bit 0, until "a" has k-bits:
-    while(bitset_count(*a) < k)
-        {   (*a)++;  c = 1;     }    // c = 1 --> lowest bit is now in bit 0
-  
-// Print:
-    //std::string abit = int_to_bstring(*a, n);
-    //std::cout << "final a = " << abit << "\t c = " << c << std::endl;
+  Parallel_Ranges(total, Nthreads, Nranges, [&](uint64_t range, uint64_t start, uint64_t count)
+    {
+      Eval_Range(Buffers[range], Missed[range], start, count);
+      if (!Buffers[range].empty())  {   Raise_Floor(Floor, Buffers[range]);   }
+    });
 
-// Stopping criteria:  position of the lowest bit before taking a = a + c,  if it is "(n-k-1)", then we're done! --> stop
-//if i_min = (n-k-1) the procedure is finished  
-    c_stop = one128 << (n-k-1);
+  Add_toOpSet(OpSet, Buffers, Nthreads);
+  if (Cache)  {   Cache_Insert(*Cache, Missed);   }
 
-    return (c == c_stop); //((c & c_stop)); // return TRUE when the procedure is done --> STOP
+  return total;
 }
 
-
-void all_int_k_bits(unsigned int k, uint32_t *compt, unsigned int n)  //only for (k <= n)
+// Evaluates the 'count' operators with k bits starting from the rank 'start', on the rows of the data (histogram 'Nvect' or its row-major copy):
+// keep the ones with a bias larger than 'Bias_LowerBound' and above the floor 'Floor' (raised during the loop)
+// The operators are taken by blocks of 'Rows_batch' successive operators: the ones that are not in the cache are evaluated
+// together with 'K1_Block' (one pass over the data per block), then the block is processed in the order of the enumeration.
+// K = k fixed at compilation (enumeration unrolled), or 0 (see 'Combination' in data.h)
+template <unsigned int K, typename DataType>
+void AllOp_kbits_Range_Rows(vector<Candidate128>& Buffer, vector<Candidate128>& Missed, const DataType& Data, unsigned int n, unsigned int k, double Nd, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, uint64_t start, uint64_t count)
 {
-    __int128_t a = (one128 << k) - 1;  // intialise "a" with the k first bits set at 1
-    bool stop = false;
+  Combination<K> C(n, k);
+  Unrank_Combination(start, n, k, C.idx);   // first operator of the range
+
+  vector<__int128_t> Block_bin(Rows_batch), Block_R0(Rows_batch), Eval_bin(Rows_batch);
+  vector<uint64_t> Block_k1(Rows_batch), Eval_k1(Rows_batch);
+  vector<size_t> Eval_pos(Rows_batch);   // position in the block of the operators evaluated on the data
+
+  Operator128 Op;
+  Floor_Check Check;   // checks of the buffer against the floor
+  uint64_t hits = 0;
+
+  for (uint64_t c = 0; c < count; c += Rows_batch)
+  {
+    size_t B = (count - c < Rows_batch)? (size_t) (count - c) : Rows_batch, Neval = 0;
+
+    // Operators of the block:  values read from the cache, or evaluated all together on the data
+    for (size_t b = 0; b < B; b++)
+    {
+      Block_bin[b] = C.bin();  Block_R0[b] = 0;
+      if (Cache)  {   for (unsigned int l = 0; l < C.k(); l++)  {   Block_R0[b] ^= Cache->Row[C.idx[l]];   }   }
+
+      if (Cache && Cache->find(Block_R0[b], &Block_k1[b]))  {   hits++;   }
+      else  {   Eval_bin[Neval] = Block_bin[b];   Eval_pos[Neval++] = b;   }
+
+      C.next();
+    }
+
+    K1_Block(Data, Eval_bin.data(), Neval, Eval_k1.data());
+    for (size_t e = 0; e < Neval; e++)
+    {
+      Block_k1[Eval_pos[e]] = Eval_k1[e];
+      if (Cache)  {   Cache->record(Block_R0[Eval_pos[e]], Eval_k1[e], Missed);   }
+    }
 
-    (*compt)++;
-    //std::cout << *compt << ": \t" << int_to_bstring(a, n) << std::endl;
+    for (size_t b = 0; b < B; b++)
+    {
+      Op.bin = Block_bin[b];
+      Op.k1 = Block_k1[b];
+      Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+      if (Op.bias > Bias_LowerBound && Floor.accept(Op.k1)) { Buffer.push_back(Make_Candidate(Op.bin, Op.k1)); }
+      if(print) {   
+        cout << int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t";
+        int_to_digits(Op.bin, n); 
+      }
+      if (Buffer.size() > Check.Nseen)  {   Check_Floor(Floor, Buffer, Check);   }
+    }
+  }
+  if (Cache)  {   Cache->Nhits += hits;   }
+}
 
-    while (!stop)
+// Loop over all the operators with k bits, evaluated on the rows of the data, with the enumeration specialised for k (k <= K_unrolled)
+// Returns the number of operators evaluated
+template <typename DataType>
+uint64_t AllOp_kbits_Loop_Rows(OpSet128& OpSet, const DataType& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, Struct_Options Opt)
+{
+  double Nd = (double) N;
+  if (k == 0 || k > n)  {   return 0;   }
+
+  return AllOp_kbits_Parallel(OpSet, n, k, print, Opt, Floor, Cache, [&](vector<Candidate128>& Buffer, vector<Candidate128>& Missed, uint64_t start, uint64_t count)
+  {
+    switch (k)
     {
-        stop = Incr_k_bits(k, &a, n);    
-        (*compt)++;   
-        //std::cout << *compt << "\t" << stop << ": \t" << int_to_bstring(a, n) << std::endl; 
+      case 2:   AllOp_kbits_Range_Rows<2>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);  break;
+      case 3:   AllOp_kbits_Range_Rows<3>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);  break;
+      case 4:   AllOp_kbits_Range_Rows<4>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);  break;
+      case 5:   AllOp_kbits_Range_Rows<5>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);  break;
+      case 6:   AllOp_kbits_Range_Rows<6>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);  break;
+      default:  AllOp_kbits_Range_Rows<0>(Buffer, Missed, Data, n, k, Nd, Bias_LowerBound, Floor, Cache, print, start, count);
     }
+  });
+}
+
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, Struct_Options Opt)
+{
+  return AllOp_kbits_Loop_Rows(OpSet, Nvect, n, N, k, Bias_LowerBound, Floor, Cache, print, Opt);
+}
 
-    //std::cout << std::endl << "total number of combinations = " << compt << std::endl;
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const Rows128& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, Struct_Options Opt)
+{
+  return AllOp_kbits_Loop_Rows(OpSet, Data, n, N, k, Bias_LowerBound, Floor, Cache, print, Opt);
 }
 
+// Same loop on the bit-sliced data, with a depth-first enumeration (see 'BitSliced.cpp'):
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const BitSliced& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, Struct_Options Opt);
+
+// Same loop on the sparse columns, with a depth-first enumeration (see 'Sparse.cpp'):
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const SparseColumns& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* Cache, bool print, Struct_Options Opt);
+
 /******************************************************************************/
-/*********************   Add all Operators with 2 bit(s)  *********************/
-/***************   All fields and all pairwise interactions   *****************/
+/*************   Operators with 2 bits from the CO-OCCURRENCE MATRIX   ********/
 /******************************************************************************/
+Cooccurrence Build_Cooccurrence(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads = 1);
+Cooccurrence Build_Cooccurrence(const Rows128& Data, unsigned int Nthreads = 1);
+Cooccurrence Build_Cooccurrence(const BitSliced& Data, unsigned int Nthreads = 1);
+Cooccurrence Build_Cooccurrence(const SparseColumns& Data, unsigned int Nthreads = 1);
+
+// Co-occurrence matrix of the data, for each type of data:
+Cooccurrence Pairs_Matrix(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads)
+  {   return Build_Cooccurrence(Nvect, n, N, Nthreads);   }
+Cooccurrence Pairs_Matrix(const Rows128& Data, unsigned int, uint64_t, unsigned int Nthreads)
+  {   return Build_Cooccurrence(Data, Nthreads);   }
+Cooccurrence Pairs_Matrix(const BitSliced& Data, unsigned int, uint64_t, unsigned int Nthreads)
+  {   return Build_Cooccurrence(Data, Nthreads);   }
+Cooccurrence Pairs_Matrix(const SparseColumns& Data, unsigned int, uint64_t, unsigned int Nthreads)
+  {   return Build_Cooccurrence(Data, Nthreads);   }
+
+// All the operators with 2 bits, read from the co-occurrence matrix:  K1(s_i + s_j) = c_i + c_j - 2*c_ij
+// (same enumeration, same floor and same accepted operators as the loop over the data, in O(1) per operator).
+// Returns the number of operators evaluated
+uint64_t AllOp_2bits_Pairs(OpSet128& OpSet, const Cooccurrence& M, unsigned int n, uint64_t N, double Bias_LowerBound, Struct_Floor& Floor, bool print, Struct_Options Opt)
+{
+  double Nd = (double) N;
+  if (n < 2)  {   return 0;   }
+
+  return AllOp_kbits_Parallel(OpSet, n, 2, print, Opt, Floor, nullptr, [&](vector<Candidate128>& Buffer, vector<Candidate128>&, uint64_t start, uint64_t count)
+  {
+    Combination<2> C(n, 2);
+    Unrank_Combination(start, n, 2, C.idx);   // first operator of the range
 
-void Add_AllOp_kbits_MostBiased(set<Operator128>& OpSet, vector<pair<__int128_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false)  
+    Operator128 Op;
+    Floor_Check Check;   // checks of the buffer against the floor
+
+    for (uint64_t c = 0; c < count; c++)
+    {
+      Op.bin = C.bin();
+      Op.k1 = M.K1_pair(C.idx[0], C.idx[1]);
+      Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+      if (Op.bias > Bias_LowerBound && Floor.accept(Op.k1)) { Buffer.push_back(Make_Candidate(Op.bin, Op.k1)); }
+      if(print) {   
+        cout << int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t";
+        int_to_digits(Op.bin, n); 
+      }
+      if (Buffer.size() > Check.Nseen)  {   Check_Floor(Floor, Buffer, Check);   }
+
+      C.next();
+    }
+  });
+}
+
+template <typename DataType>
+void Add_AllOp_kbits_MostBiased_Data(OpSet128& OpSet, const DataType& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, bool print, Struct_Options Opt, Cache_R0* Cache)
 {
   auto start = chrono::system_clock::now(); 
 
   cout << "Current smallest 'Bias' = " << Bias_LowerBound ;
   cout << "\t --> all operator with smaller 'Bias' will be rejected" << endl;
 
-  double Nd = (double) N;
-  unsigned int OpSet_Size0 = OpSet.size();
-
   cout << "Start iteration: k = " << k << endl;
 
-// intialise "Op_bin" with the "k" first bits set at 1 --> first operator:
-  __int128_t Op_bin = (one128 << k) - 1; 
-  Operator128 Op = Value_Op(Op_bin, Nvect, Nd);
-  if (Op.bias > Bias_LowerBound)  { OpSet.insert(Op); }
-  uint32_t compt = 1;
+  // Floor raised during the loop, from the operators already in OpSet:
+  Struct_Floor Floor;
+  Init_Floor(Floor, OpSet, n);
 
-  if(print) {   
-    cout << int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t";
-    int_to_digits(Op.bin, n); 
-    } //", \t Elapsed time (in s): " << elapsed.count() << endl; 
+  uint64_t Nhits0 = (Cache)? Cache->Nhits.load() : 0;
 
-  bool stop = false;
-  while (!stop)
-  {
-    stop = Incr_k_bits(k, &Op_bin, n); 
-    Op = Value_Op(Op_bin, Nvect, Nd);
-    if (Op.bias > Bias_LowerBound) { OpSet.insert(Op); }  
-    if(print) {   
-      cout << int_to_bstring(Op.bin, n) << "\t Bias = " << Op.bias << "\t";
-      int_to_digits(Op.bin, n); 
-    } //", \t Elapsed time (in s): " << elapsed.count() << endl; 
-    compt++;
-  } 
+  // k = 2:  all the values at once from the co-occurrence matrix of the variables
+  uint64_t compt = (k == 2 && Opt.pairs)? AllOp_2bits_Pairs(OpSet, Pairs_Matrix(Data, n, N, Opt.threads), n, N, Bias_LowerBound, Floor, print, Opt)
+                                        : AllOp_kbits_Loop(OpSet, Data, n, N, k, Bias_LowerBound, Floor, Cache, print, Opt);
+  // Final floor, from the greedy basis of the merged OpSet (same result for any number of threads):
+  Cut_Floor(OpSet, Floor);
 
-  cout << "End iteration: k = " << k << "\t total number of combinations = " << compt << "\t total number of accepted operators = " << OpSet.size() - OpSet_Size0 << endl;
+  size_t Naccepted = 0;   // operators with k bits above the final floor
+  for (auto& Op : OpSet.Op)  {   if (bitset_count(Op.bin()) == k)  {   Naccepted++;   }   }
+
+  cout << "End iteration: k = " << k << "\t total number of combinations = " << compt << "\t total number of accepted operators = " << Naccepted << endl;
+  cout << "Floor at the end of the iteration: 'Bias' = " << ((double) Floor.W.load()) / (2. * N);
+  cout << "\t --> number of operators kept = " << OpSet.size() << endl;
+  if (Cache)
+  {
+    cout << "Cache of the values in R0: " << Cache->Nhits.load() - Nhits0 << " values read from the cache";
+    cout << ", \t " << Cache->Nentries << " values stored (" << Cache->Slot.size() * sizeof(Candidate128) / 1024. / 1024. << " MB)" << endl;
+  }
 
   auto end = chrono::system_clock::now();  
   chrono::duration<double> elapsed = end - start;
@@ -262,57 +483,41 @@ void Add_AllOp_kbits_MostBiased(set<Operator128>& OpSet, vector<pair<__int128_t,
   cout << endl;
 }
 
-
-/******************************************************************************/
-/********************   All Operators with k bits or less  ********************/
-/*******************   All interactions of order k or less   ******************/
-/******************************************************************************/
-/*
-set<Operator128> all_Op_UpTo_k_bits_MostBiased_rank64(vector<pair<uint64_t, unsigned int>> Nvect, unsigned int n, unsigned int N, unsigned int k, double Bias_LowerBound=0, bool print = false) 
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, vector<pair<__int128_t, uint64_t>> Nvect, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr)  
 {
-  set<Operator128> OpSet; // Set of all the fields and pairwise operators ordered by bias 
-  Operator128 Op;
-
-  uint64_t Op_bin = 0;
-  bool stop = false;
-  double Nd = (double) N;
-  //double sig_lim = alpha * 0.5 / sqrt(Nd);
+  Add_AllOp_kbits_MostBiased_Data(OpSet, Nvect, n, N, k, Bias_LowerBound, print, Opt, Cache);
+}
 
-  for (unsigned int ki=1; ki<=k; ki++)
-  {
-    Op_bin = (one128 << ki) - 1;  // intialise "a" with the ki first bits set at 1
-    Op = Value_Op(Op_bin, Nvect, Nd);
-    if (Op.bias > Bias_LowerBound) { OpSet.insert(Op); }
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const Rows128& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr)  
+{
+  Add_AllOp_kbits_MostBiased_Data(OpSet, Data, n, N, k, Bias_LowerBound, print, Opt, Cache);
+}
 
-    //std::cout << int_to_bstring(Op_bin, n) << std::endl;
-    if(print)
-      {   std::cout << "Starts ki = " << ki << endl;  }
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const BitSliced& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr)  
+{
+  Add_AllOp_kbits_MostBiased_Data(OpSet, Data, n, N, k, Bias_LowerBound, print, Opt, Cache);
+}
 
-    stop = false;
-    while (!stop)
-      {
-        stop = Incr_k_bits(k, &Op_bin, n); 
-        Op = Value_Op(Op_bin, Nvect, Nd);
-        if (Op.bias > Bias_LowerBound) { OpSet.insert(Op); }
-        //std::cout << stop << ": \t" << int_to_bstring(Op_bin, n) << std::endl; 
-      } 
-  }
-  return OpSet;
+void Add_AllOp_kbits_MostBiased(OpSet128& OpSet, const SparseColumns& Data, unsigned int n, uint64_t N, unsigned int k = 2, double Bias_LowerBound=0, bool print = false, Struct_Options Opt = Struct_Options(), Cache_R0* Cache = nullptr)  
+{
+  Add_AllOp_kbits_MostBiased_Data(OpSet, Data, n, N, k, Bias_LowerBound, print, Opt, Cache);
 }
-*/
+
 
 /******************************************************************************/
 /********************   REMOVE OPERATORS with SMALL BIAS  *********************/
 /******************************************************************************/
-void CutSmallBias(set<Operator128>& OpSet, Struct_LowerBound LB)
+void CutSmallBias(OpSet128& OpSet, Struct_LowerBound LB)
 {
   cout << "-->> Remove operators with small bias:" << endl;
   cout << "\t Smallest Bias accepted = " << LB.Bias << endl; 
   cout << "\t Number of Operators left = " << (LB.Index + 1) << endl;  // indexing of the operators starts from '0', hence the '+1'
 
-  set<Operator128>::iterator it = OpSet.begin();
-  advance(it, (LB.Index+1));
-  OpSet.erase (it, OpSet.end());
+  if (LB.Index + 1 < OpSet.size())
+  {
+    OpSet.Op.resize(LB.Index + 1);
+    OpSet.Op.shrink_to_fit();
+  }
 
   cout << endl;
 }
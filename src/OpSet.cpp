@@ -0,0 +1,267 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+/******************************************************************************/
+/***************************   OPERATOR and CANDIDATE   **********************/
+/******************************************************************************/
+Candidate128 Make_Candidate(__int128_t Op_bin, uint64_t k1)
+{
+  Candidate128 C;
+  C.bin_lo = (uint64_t) Op_bin;
+  C.bin_hi = (uint64_t) (((unsigned __int128) Op_bin) >> 64);
+  C.k1 = k1;
+  return C;
+}
+
+// ******* Data averages are taken using ISING convention: ******************** /
+inline double Bias(uint64_t k1, uint64_t N)
+  {   return fabs((((double) k1) / ((double) N)) -0.5);   }  //fabs(p1-0.5);
+
+Operator128 OpSet128::at(size_t i) const
+{
+  Operator128 Op_i;
+
+  Op_i.bin = Op[i].bin();
+  Op_i.k1 = Op[i].k1;
+  Op_i.bias = Bias(Op_i.k1, N);
+
+  return Op_i;
+}
+
+/******************************************************************************/
+/*******************************   RANKING   **********************************/
+/******************************************************************************/
+// Distance to the largest possible bias:  D = N - |2*K1 - N|  (D = 0 for the most biased operators)
+// The key is 2*D + t: the bias of 'K1' and of 'N-K1' (same D) can differ by one ulp once computed in double,
+// the bit 't' = 1 for the smaller of the two keeps the ranking of the operators identical to the one of 'Operator128'.
+inline uint64_t Rank_Key(const Candidate128& C, uint64_t N)
+{
+  int64_t W = 2 * ((int64_t) C.k1) - ((int64_t) N);
+  uint64_t D = ((uint64_t) N) - ((uint64_t) ((W < 0)? -W : W));
+  return 2 * D + ((Bias(C.k1, N) < Bias(N - C.k1, N))? 1 : 0);
+}
+
+inline unsigned int Order(const Candidate128& C)
+  {   return __builtin_popcountll(C.bin_lo) + __builtin_popcountll(C.bin_hi);   }
+
+// True if 'a' is ranked before 'b':
+inline bool Ranked_Before(const Candidate128& a, const Candidate128& b, uint64_t N)
+{
+  uint64_t Da = Rank_Key(a, N), Db = Rank_Key(b, N);
+  if (Da != Db)  {   return Da < Db;   }
+
+  unsigned int ka = Order(a), kb = Order(b);
+  if (ka != kb)  {   return ka < kb;   }
+
+  return (a.bin_hi != b.bin_hi)? (a.bin_hi < b.bin_hi) : (a.bin_lo < b.bin_lo);
+}
+
+/******************************************************************************/
+/*****************************   LSD RADIX SORT   *****************************/
+/******************************************************************************/
+// One stable pass of counting sort on the byte 'Byte(C)' of the candidates:
+// the pass is skipped if all the candidates have the same byte.
+template <typename ByteFunction>
+void Radix_Pass(vector<Candidate128>& A, vector<Candidate128>& Tmp, ByteFunction Byte)
+{
+  size_t count[256] = {0};
+  for (auto& C : A)  {   count[Byte(C)]++;   }
+
+  size_t pos = 0, c = 0;
+  for (unsigned int b = 0; b < 256; b++)
+  {
+    if (count[b] == A.size())  {   return;   }
+    c = count[b];  count[b] = pos;  pos += c;
+  }
+
+  Tmp.resize(A.size());
+  for (auto& C : A)  {   Tmp[count[Byte(C)]++] = C;   }
+  A.swap(Tmp);
+}
+
+// Sort the candidates in the ranking order, with passes from the least significant byte of the ranking:
+//   bytes of the operator (only the ones that are used), then order of the operator, then bytes of the key 2*D+t (see 'Rank_Key').
+void Sort_Candidates(vector<Candidate128>& Batch, uint64_t N)
+{
+  if (Batch.size() < 2)  {   return;   }
+
+  vector<Candidate128> Tmp;
+
+  uint64_t used_lo = 0, used_hi = 0;   // bits used by the operators
+  for (auto& C : Batch)  {   used_lo |= C.bin_lo;   used_hi |= C.bin_hi;   }
+
+  for (unsigned int b = 0; b < 8 && (used_lo >> (8*b)); b++)
+    {   Radix_Pass(Batch, Tmp, [b](const Candidate128& C) {   return (unsigned int) ((C.bin_lo >> (8*b)) & 0xFF);   });   }
+  for (unsigned int b = 0; b < 8 && (used_hi >> (8*b)); b++)
+    {   Radix_Pass(Batch, Tmp, [b](const Candidate128& C) {   return (unsigned int) ((C.bin_hi >> (8*b)) & 0xFF);   });   }
+
+  Radix_Pass(Batch, Tmp, [](const Candidate128& C) {   return Order(C);   });   // order <= 128
+
+  uint64_t Key_max = 2 * ((uint64_t) N) + 1;
+  for (unsigned int b = 0; b < 8 && (Key_max >> (8*b)); b++)
+    {   Radix_Pass(Batch, Tmp, [b, N](const Candidate128& C) {   return (unsigned int) ((Rank_Key(C, N) >> (8*b)) & 0xFF);   });   }
+}
+
+/******************************************************************************/
+/***************************   MERGE in the SET   *****************************/
+/******************************************************************************/
+// Merge two sorted vectors of candidates:
+vector<Candidate128> Merge_Candidates(const vector<Candidate128>& A, const vector<Candidate128>& B, uint64_t N)
+{
+  vector<Candidate128> C(A.size() + B.size());
+  merge(A.begin(), A.end(), B.begin(), B.end(), C.begin(), [N](const Candidate128& a, const Candidate128& b) {   return Ranked_Before(a, b, N);   });
+  return C;
+}
+
+// Add a batch of candidates to the set (the batch is sorted, then merged with the set):
+void Add_toOpSet(OpSet128& OpSet, vector<Candidate128>& Batch)
+{
+  Sort_Candidates(Batch, OpSet.N);
+
+  if (OpSet.Op.empty())  {   OpSet.Op.swap(Batch);   }
+  else  {   OpSet.Op = Merge_Candidates(OpSet.Op, Batch, OpSet.N);   }
+
+  vector<Candidate128>().swap(Batch);   // free the batch
+}
+
+// Add several batches of candidates to the set:
+// the batches are sorted in parallel, then merged two by two (in parallel), then merged with the set.
+void Add_toOpSet(OpSet128& OpSet, vector<vector<Candidate128>>& Batches, unsigned int Nthreads = 1)
+{
+  uint64_t N = OpSet.N;
+
+  Parallel_Ranges(Batches.size(), Nthreads, Batches.size(), [&](uint64_t, uint64_t start, uint64_t)
+    {   Sort_Candidates(Batches[start], N);   });
+
+  for (size_t step = 1; step < Batches.size(); step *= 2)
+  {
+    uint64_t Npairs = (Batches.size() + 2*step - 1) / (2*step);
+    Parallel_Ranges(Npairs, Nthreads, Npairs, [&](uint64_t, uint64_t start, uint64_t)
+    {
+      size_t i = start * 2 * step, j = i + step;
+      if (j < Batches.size())
+      {
+        Batches[i] = Merge_Candidates(Batches[i], Batches[j], N);
+        vector<Candidate128>().swap(Batches[j]);
+      }
+    });
+  }
+
+  if (Batches.empty())  {   return;   }
+
+  if (OpSet.Op.empty())  {   OpSet.Op.swap(Batches[0]);   }
+  else  {   OpSet.Op = Merge_Candidates(OpSet.Op, Batches[0], N);   }
+
+  vector<Candidate128>().swap(Batches[0]);
+}
+
+/******************************************************************************/
+/**********************   FLOOR RAISED DURING THE ENUMERATION   ***************/
+/******************************************************************************/
+bool Add_Echelon(Echelon_Basis& E, __int128_t Op);
+
+inline uint64_t Abs_W(const Candidate128& C, uint64_t N)
+{
+  int64_t W = 2 * ((int64_t) C.k1) - ((int64_t) N);
+  return (uint64_t) ((W < 0)? -W : W);
+}
+
+// The seed is the greedy basis of the operators already in OpSet (the fields, or the operators kept at the previous step):
+// the floor starts at the smallest |2*K1 - N| of this basis.
+void Init_Floor(Struct_Floor& Floor, const OpSet128& OpSet, unsigned int n)
+{
+  Floor.N = OpSet.N;
+  Floor.n = n;
+  Floor.Seed.clear();
+
+  Echelon_Basis E;
+  for (size_t i = 0; i < OpSet.size() && E.rank < n; i++)
+  {
+    if (Add_Echelon(E, OpSet.Op[i].bin()))  {   Floor.Seed.push_back(OpSet.Op[i]);   }
+  }
+
+  Floor.W.store((E.rank == n)? Abs_W(Floor.Seed.back(), Floor.N) : 0);
+  Floor.Nbuffered.store(0);
+  Floor.Next.store(Floor_batch);
+}
+
+// Greedy basis of (Seed + Buffer): it becomes the new seed, so that the next checks of all the ranges start from it;
+// if it has 'n' operators, its smallest |2*K1 - N| is a floor for all the other threads;
+// the operators of the buffer below the (possibly higher) shared floor are then removed.
+// Returns the size of the buffer after the removal.
+size_t Raise_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer)
+{
+  uint64_t N = Floor.N;
+  Sort_Candidates(Buffer, N);
+
+  {
+    lock_guard<mutex> lock(Floor.Seed_mutex);
+
+    Echelon_Basis E;
+    vector<Candidate128> Basis;
+    size_t i = 0, j = 0;   // current operator in the seed and in the buffer
+    while (E.rank < Floor.n && (i < Floor.Seed.size() || j < Buffer.size()))
+    {
+      const Candidate128& C = (j == Buffer.size() || (i < Floor.Seed.size() && Ranked_Before(Floor.Seed[i], Buffer[j], N)))? Floor.Seed[i++] : Buffer[j++];
+      if (Add_Echelon(E, C.bin()))  {   Basis.push_back(C);   }
+    }
+    Floor.Seed.swap(Basis);
+
+    if (E.rank == Floor.n)
+    {
+      uint64_t W = Floor.W.load(), W_last = Abs_W(Floor.Seed.back(), N);
+      while (W_last > W && !Floor.W.compare_exchange_weak(W, W_last))  {}
+    }
+  }
+
+  // The buffer is sorted: remove the operators below the floor at its end
+  uint64_t W = Floor.W.load();
+  size_t size = Buffer.size();
+  while (size > 0 && Abs_W(Buffer[size-1], N) < W)  {   size--;   }
+  Buffer.resize(size);
+
+  return size;
+}
+
+// Counts the operators added to the buffer since the last call, in the total of the buffers of all the ranges;
+// each time this total grows by 'Floor_batch', the range that sees it raises the floor with its buffer:
+// the floor is then raised as often with many small ranges (several threads) as with a single range.
+void Check_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer, Floor_Check& Check)
+{
+  uint64_t total = Floor.Nbuffered.fetch_add(Buffer.size() - Check.Nseen) + (Buffer.size() - Check.Nseen);
+  Check.Nseen = Buffer.size();
+
+  uint64_t next = Floor.Next.load();
+  if (total < next || Buffer.size() < Check.next_size)  {   return;   }
+  if (!Floor.Next.compare_exchange_strong(next, total + Floor_batch))  {   return;   }   // check done by another range
+
+  Check.Nseen = Raise_Floor(Floor, Buffer);
+  Check.next_size = 2 * Check.Nseen;
+}
+
+// Remove the operators of OpSet below the final floor:  the floor is computed again from the greedy basis of the merged OpSet,
+// so that it doesn't depend on the floors reached by the ranges during the loop (nor on the number of threads).
+// The operators rejected during the loop were below a floor obtained from a subset of the operators, which is never above this one.
+void Cut_Floor(OpSet128& OpSet, Struct_Floor& Floor)
+{
+  Init_Floor(Floor, OpSet, Floor.n);
+
+  uint64_t W = Floor.W.load();
+  size_t size = OpSet.size();
+  while (size > 0 && Abs_W(OpSet.Op[size-1], OpSet.N) < W)  {   size--;   }
+  OpSet.Op.resize(size);
+}
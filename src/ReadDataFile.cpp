@@ -3,6 +3,20 @@
 #include <map>
 #include <vector>
 #include <list>
+#include <queue>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+
+#if defined(__SSE2__)
+#include <immintrin.h> // for the SIMD parser
+#endif
 
 #include <ctime> // for chrono
 #include <ratio> // for chrono
@@ -22,41 +36,133 @@ unsigned int bitset_count(__int128_t bool_nb);
 /**************************     READ FILE    **********************************/
 /******************************************************************************/
 /**************    READ DATA and STORE them in Nset    ************************/
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+vector<pair<__int128_t, uint64_t>> Merge_Histograms(vector<Histogram128>& Histo);
+
+// Reverse the order of the 64 bits of x:
+inline uint64_t Reverse_Bits64(uint64_t x)
+{
+  x = __builtin_bswap64(x);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  return x;
+}
+
+// Mask of the W characters in p[0, W) (bit i = 1 iff p[i] == '1') --> bits of the state from 'bit_high' down to 'bit_high - W + 1':
+template <unsigned int W>
+inline __int128_t Mask_toState(uint64_t mask, unsigned int bit_high)
+  {   return (__int128_t) (((unsigned __int128) (Reverse_Bits64(mask) >> (64 - W))) << (bit_high + 1 - W));   }
+
+// State written in the 'r' first characters of a line (first character = highest bit; the characters other than '1' are read as '0'):
+// the characters are compared to '1' by 64, 32 or 16 at a time (depending on the instruction set), then one at a time for the end of the line.
+// Only the characters of the line are read, so short (malformed) lines are handled as before.
+inline __int128_t Parse_State(const char* line, size_t len, unsigned int r)
+{
+  __int128_t state = 0;
+  size_t len_r = (len < r)? len : r;
+  size_t pos = 0;
+
+#if defined(__AVX512BW__)
+  for (; pos + 64 <= len_r; pos += 64)
+  {
+    uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*) (line + pos)), _mm512_set1_epi8('1'));
+    state |= Mask_toState<64>(mask, r - 1 - pos);
+  }
+#endif
+#if defined(__AVX2__)
+  for (; pos + 32 <= len_r; pos += 32)
+  {
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (line + pos)), _mm256_set1_epi8('1')));
+    state |= Mask_toState<32>(mask, r - 1 - pos);
+  }
+#endif
+#if defined(__SSE2__)
+  for (; pos + 16 <= len_r; pos += 16)
+  {
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (line + pos)), _mm_set1_epi8('1')));
+    state |= Mask_toState<16>(mask, r - 1 - pos);
+  }
+#endif
+
+  for (; pos < len_r; pos++)
+    {   if (line[pos] == '1')  {   state |= (one128 << (r - 1 - pos));   }   }
+  return state;
+}
 
-vector<pair<__int128_t, unsigned int>> read_datafile128_vect(string datafilename, unsigned int *N, unsigned int r)    // O(N)  where N = data set size
+// Histogram of the lines of [begin, end) (each line ends with '\n', except maybe the last line of the file):
+uint64_t Histogram_Lines(const char* begin, const char* end, unsigned int r, Histogram128& Histo)
+{
+  uint64_t N = 0;
+  const char* line = begin;
+
+  while (line < end)
+  {
+    const char* eol = (const char*) memchr(line, '\n', end - line);
+    if (eol == nullptr)  {   eol = end;   }
+
+    Histo.add(Parse_State(line, eol - line, r), 1);
+
+    N++;
+    line = eol + 1;
+  }
+  return N;
+}
+
+// The file is memory-mapped and split in 'Nthreads' pieces of complete lines:
+// each piece is read by a thread in its own hash table, then the tables are merged in Nvect (ordered by increasing state).
+vector<pair<__int128_t, uint64_t>> read_datafile128_vect(string datafilename, uint64_t *N, unsigned int r, unsigned int Nthreads = 1)    // O(N)  where N = data set size
 {
   auto start = chrono::system_clock::now();
 
   cout << endl << "--->> Read the datafile: \"" << datafilename << "\", \t Build Nset..." << endl;
   cout << "\t Number of variables to read: n = " << r << endl;
 
-  string line, line2;     char c = '1';
-  __int128_t state = 0, Op;
   (*N) = 0;            // N = dataset sizes
+  if (Nthreads < 1)  {   Nthreads = 1;   }
 
 // ***** The data is stored in Nset as an histogram:  ********************************
-  map<__int128_t, unsigned int> Nset; // Nset[mu] = #of time state mu appears in the data set
+  vector<Histogram128> Histo(Nthreads); // Histo[thread] = #of time each state mu appears in the piece of the thread
 
-  ifstream myfile (datafilename.c_str());
-  if (myfile.is_open())
+  int fd = open(datafilename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd >= 0 && fstat(fd, &file_stat) == 0)
   {
-    while ( getline (myfile,line))
+    size_t size = file_stat.st_size;
+    const char* Data = nullptr;
+    if (size > 0)
     {
-      line2 = line.substr (0,r);          //take the r first characters of line
-      Op = one128 << (r - 1);
-      state = 0;
-      for (auto &elem: line2)     //convert string line2 into a binary integer
+      void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED)  {   Data = (const char*) map;   madvise(map, size, MADV_SEQUENTIAL);   }
+      else  {   cout << endl << "--->> Unable to map the file in memory." << endl;   }
+    }
+
+    if (Data != nullptr)
+    {
+      // Pieces of complete lines:
+      vector<size_t> cut(Nthreads + 1, size);
+      cut[0] = 0;
+      for (unsigned int p = 1; p < Nthreads; p++)
       {
-        if (elem == c) { state += Op; }
-        Op = Op >> 1;
+        size_t c = (size * p) / Nthreads;
+        if (c < cut[p-1])  {   c = cut[p-1];   }
+        while (c > 0 && c < size && Data[c - 1] != '\n')  {   c++;   }
+        cut[p] = c;
       }
-      Nset[state] += 1;
-      (*N)++;
+
+      vector<uint64_t> N_piece(Nthreads, 0);
+      Parallel_Ranges(Nthreads, Nthreads, Nthreads, [&](uint64_t, uint64_t p, uint64_t)
+        {   N_piece[p] = Histogram_Lines(Data + cut[p], Data + cut[p+1], r, Histo[p]);   });
+
+      for (auto& Np : N_piece)  {   (*N) += Np;   }
+      munmap((void*) Data, size);
     }
-    myfile.close();
+    close(fd);
   }
   else cout << endl << "--->> Unable to open file: Check datafilename and location." << endl << endl;
 
+  vector<pair<__int128_t, uint64_t>> Nvect = Merge_Histograms(Histo);
+
   if ((*N) == 0) 
     { 
     cout << endl << "--->> Failure to read the file, or file is empty:  Terminate." << endl << endl;
@@ -65,17 +171,9 @@ vector<pair<__int128_t, unsigned int>> read_datafile128_vect(string datafilename
     {
     cout << endl << "--->> File has been read successfully:" << endl;
     cout << "\t Data size, N = " << (*N) << endl;
-    cout << "\t Number of different states, Nset.size() = " << Nset.size() << endl << endl;
+    cout << "\t Number of different states, Nset.size() = " << Nvect.size() << endl << endl;
     }
 
-  vector<pair<__int128_t, unsigned int>> Nvect(Nset.size());
-  int i=0;
-  for (auto& my_pair : Nset)
-  {
-    Nvect[i]=my_pair;
-    i++;
-  }
-
   auto end = chrono::system_clock::now();  
   chrono::duration<double>  elapsed = end - start;
   cout << endl << "Elapsed time (in s): " << elapsed.count() << endl << endl;  
@@ -84,7 +182,7 @@ vector<pair<__int128_t, unsigned int>> read_datafile128_vect(string datafilename
 }
 
 /****************    PRINT Nset in file:    ************************/
-/*void read_Nset (map<uint32_t, unsigned int> Nset, unsigned int N, string OUTPUTfilename)
+/*void read_Nset (map<uint32_t, unsigned int> Nset, uint64_t N, string OUTPUTfilename)
 // map.second = nb of time that the state map.first appears in the data set
 {
   map<uint32_t, unsigned int>::iterator it;
@@ -144,40 +242,76 @@ __int128_t transform_mu_basis(__int128_t mu, list<__int128_t> basis)
 }
 
 
+/******************************************************************************/
+/*****************   CHANGE of BASIS: tables of the bytes    ******************/
+/******************************************************************************/
+// The change of basis is linear:  new state = XOR of the columns C_i of the old bits i that are '1',
+// where the column C_i has its bit j equal to bit i of the basis operator j.
+// The columns are grouped by bytes of the old state:  Table[b*256 + v] = XOR of the columns C_{8b+t} for the bits t of v;
+// a state is then transformed with one load and one XOR per byte (16 for n = 128), instead of n popcounts.
+struct Basis_Table
+{
+  unsigned int Nbytes = 0;           // number of bytes of the old states
+  vector<__int128_t> Table;          // 256 values per byte
+};
+
+Basis_Table Build_Basis_Table(const vector<Operator128>& Basis, unsigned int n)
+{
+  Basis_Table BT;
+  BT.Nbytes = (n + 7) / 8;
+  BT.Table.assign(((size_t) BT.Nbytes) * 256, 0);
+
+  vector<__int128_t> C(8 * BT.Nbytes, 0);   // columns
+  for (unsigned int j = 0; j < Basis.size(); j++)
+  {
+    for (unsigned int i = 0; i < n; i++)
+      {   if ((Basis[j].bin >> i) & one128)  {   C[i] |= (one128 << j);   }   }
+  }
+
+  for (unsigned int b = 0; b < BT.Nbytes; b++)
+  {
+    __int128_t* T = BT.Table.data() + ((size_t) b) * 256;
+    for (unsigned int v = 1; v < 256; v++)   // T[v] = T[v without its lowest bit] XOR column of its lowest bit
+      {   T[v] = T[v & (v - 1)] ^ C[8*b + __builtin_ctz(v)];   }
+  }
+
+  return BT;
+}
+
+inline __int128_t transform_mu_table(__int128_t mu, const Basis_Table& BT)
+{
+  __int128_t final_mu = 0;
+  unsigned __int128 u = (unsigned __int128) mu;
+
+  for (unsigned int b = 0; b < BT.Nbytes; b++, u >>= 8)
+    {   final_mu ^= BT.Table[(b << 8) | (unsigned int) (u & 0xFF)];   }
+
+  return final_mu;
+}
+
 /******************************************************************************/
 /******************** CHANGE of BASIS: build K_SET ****************************/
 /******************************************************************************/
 // Build Kvect for the states written in the basis of the m-chosen independent 
 // operator on which the SC model is based:
+vector<pair<__int128_t, uint64_t>> Build_Histogram(size_t Npairs, unsigned int Nthreads, const function<pair<__int128_t, uint64_t>(size_t)>& Pair);
 
-vector<pair<__int128_t, unsigned int>> build_Kvect(vector<pair<__int128_t, unsigned int>> Nvect, list<__int128_t> Basis)
+// Each state of Nvect is transformed with the tables of the basis, and the histogram of the new states is built in parallel
+// (hash tables or radix sort, see 'Histogram.cpp'), without any allocation per state;  Kvect is ordered by increasing state.
+vector<pair<__int128_t, uint64_t>> build_Kvect(const vector<pair<__int128_t, uint64_t>>& Nvect, const vector<Operator128>& Basis, unsigned int n, unsigned int Nthreads = 1)
 // sig_m = sig in the new basis and cut on the m first spins 
 // Kvect[sig_m] = #of time state mu_m appears in the data set
 {
-    map<__int128_t, unsigned int > Kvect_map;
-    __int128_t sig_m;    // transformed state and to the m first spins
+    Basis_Table BT = Build_Basis_Table(Basis, n);
 
 // ***** Build Kvect: *************************************************************************************
     cout << endl << "--->> Build Kvect..." << endl;
     cout << "## Basis elements are ordered from the right (s_1) to the left (s_n)." << endl;
 
-    for (auto const& it : Nvect)
-    {
-        sig_m = transform_mu_basis((it).first, Basis); // transform the initial state s=(it).first into the new basis
-        Kvect_map[sig_m] += ((it).second); // ks = (it).second = number of time state s appear in the dataset
-    }
+    vector<pair<__int128_t, uint64_t>> Kvect = Build_Histogram(Nvect.size(), Nthreads, [&](size_t i)
+      {   return pair<__int128_t, uint64_t>(transform_mu_table(Nvect[i].first, BT), Nvect[i].second);   });
     cout << endl;
 
-// ***** Convert map to a vector:  for faster reading later on ********************************************
-    vector<pair<__int128_t, unsigned int>> Kvect(Kvect_map.size());
-
-    int i=0;
-    for (auto& my_pair : Kvect_map)
-    {
-        Kvect[i]=my_pair;
-        i++;
-    }
-
     cout << "\t Kvect.size() = " << Kvect.size() << endl;
 
     return Kvect;
@@ -186,49 +320,112 @@ vector<pair<__int128_t, unsigned int>> build_Kvect(vector<pair<__int128_t, unsig
 /******************************************************************************/
 /*********************   TRANSFORM DATASET to a NEW BASIS    ******************/
 /******************************************************************************/
-string filename_remove_extension(string filename);
-string int_to_bstring(__int128_t bool_nb, unsigned int n);
+// Size of the blocks of the file read at once, and number of pieces per thread in each block:
+const size_t Convert_block = 64 * 1024 * 1024;
+const unsigned int Convert_pieces = 4;
+
+// Convert the lines of [begin, end) (each line ends with '\n', except maybe the last line of the file), and write the new states in 'out':
+uint64_t Convert_Lines(const char* begin, const char* end, unsigned int r, const Basis_Table& BT, string& out)
+{
+  uint64_t N = 0;
+  const char* line = begin;
+
+  out.clear();
+  out.reserve(end - begin + 1024);
+
+  while (line < end)
+  {
+    const char* eol = (const char*) memchr(line, '\n', end - line);
+    if (eol == nullptr)  {   eol = end;   }
+
+    __int128_t state_new = transform_mu_table(Parse_State(line, eol - line, r), BT);
 
-void convert_datafile_to_NewBasis(string input_datafile, string output_datafile, unsigned int r, vector<Operator128> BestBasis_vect)    // O(N)  where N = data set size
+    size_t pos = out.size();
+    out.resize(pos + r + 1);
+    for (unsigned int i = 0; i < r; i++)
+      {   out[pos + i] = ((state_new >> (r - 1 - i)) & one128)? '1' : '0';   }
+    out[pos + r] = '\n';
+
+    N++;
+    line = eol + 1;
+  }
+  return N;
+}
+
+// The file is read by blocks of 'Convert_block' bytes (cut at the end of a line); each block is split in pieces of complete lines,
+// that are converted in parallel ('Nthreads' threads) in separate buffers, then written in order:  the output file doesn't depend on 'Nthreads'.
+void convert_datafile_to_NewBasis(string input_datafile, string output_datafile, unsigned int r, vector<Operator128> BestBasis_vect, unsigned int Nthreads = 1)    // O(N)  where N = data set size
 {
   auto start = chrono::system_clock::now();
 
-  list<__int128_t> Basis_li;
-  for(auto& Op:BestBasis_vect)  { Basis_li.push_back(Op.bin);  }  // extract the integer representation of the basis operators:
+  Basis_Table BT = Build_Basis_Table(BestBasis_vect, r);
 
   cout << endl << "--->> Read the datafile: \"" << input_datafile << "\"" << endl;
   cout << "\t Number of variables to read: n = " << r << endl;
 
   string New_datafilename = output_datafile + "_inBestBasis.dat";
-  fstream file_newdata(New_datafilename, ios::out);
 
   cout << endl << "--->> Transform to new basis...";
   cout << endl << "\t Write the new dataset in the file: \"" << New_datafilename << "\"" << endl;
 
-  string line, line2;     char c = '1';
-  __int128_t state = 0, state_new = 0, Op;
-  unsigned int N = 0;            // N = dataset sizes
+  uint64_t N = 0;            // N = dataset sizes
+  if (Nthreads < 1)  {   Nthreads = 1;   }
 
 // ***** Read the original data and convert in new basis:  ********************************
 
-  ifstream file_data ((input_datafile).c_str());
+  ifstream file_data (input_datafile.c_str(), ios::binary);
   if (file_data.is_open())
   {
-    while (getline (file_data,line))
+    ofstream file_newdata(New_datafilename, ios::out | ios::binary);
+
+    unsigned int Npieces = Convert_pieces * Nthreads;
+    vector<char> Block;
+    vector<string> Out(Npieces);
+    size_t carry = 0;    // beginning of an incomplete line, at the end of the previous block
+
+    while (true)
     {
-      line2 = line.substr (0,r);          //take the r first characters of line
-      Op = one128 << (r - 1);
-      state = 0;
-      for (auto &elem: line2)     //convert string line2 into a binary integer
+      Block.resize(carry + Convert_block);
+      file_data.read(Block.data() + carry, Convert_block);
+      size_t size = carry + file_data.gcount();
+      bool eof = (file_data.gcount() < (streamsize) Convert_block);
+
+      // End of the last complete line of the block (at the end of the file, the last line may have no '\n'):
+      size_t end = size;
+      if (!eof)
+      {
+        while (end > 0 && Block[end - 1] != '\n')  {   end--;   }
+        if (end == 0)  {   carry = size;   continue;   }   // no complete line yet: read more
+      }
+
+      // Pieces of complete lines:
+      vector<size_t> cut(Npieces + 1, end);
+      cut[0] = 0;
+      for (unsigned int p = 1; p < Npieces; p++)
       {
-        if (elem == c) { state += Op; }
-        Op = Op >> 1;
+        size_t c = (end * p) / Npieces;
+        if (c < cut[p-1])  {   c = cut[p-1];   }
+        while (c > 0 && c < end && Block[c - 1] != '\n')  {   c++;   }
+        cut[p] = c;
       }
-      state_new = transform_mu_basis(state, Basis_li);
-      file_newdata << int_to_bstring(state_new, r) << endl;
-      //int_to_digits_file(state_new, r, file_newdata);
-      N++;
+
+      vector<uint64_t> N_piece(Npieces, 0);
+      Parallel_Ranges(Npieces, Nthreads, Npieces, [&](uint64_t, uint64_t p, uint64_t)
+        {   N_piece[p] = Convert_Lines(Block.data() + cut[p], Block.data() + cut[p+1], r, BT, Out[p]);   });
+
+      for (unsigned int p = 0; p < Npieces; p++)
+      {
+        file_newdata.write(Out[p].data(), Out[p].size());
+        N += N_piece[p];
+      }
+
+      if (eof)  {   break;   }
+
+      // Incomplete line at the end of the block:
+      carry = size - end;
+      memmove(Block.data(), Block.data() + end, carry);
     }
+
     file_data.close();
     file_newdata.close();
   }
@@ -253,4 +450,532 @@ void convert_datafile_to_NewBasis(string input_datafile, string output_datafile,
   cout << endl << "Elapsed time (in s): " << elapsed.count() << "\t for converting data" << endl << endl;  
 }
 
+/******************************************************************************/
+/*******************   BINARY HISTOGRAM of the DATA (.nset)   *****************/
+/******************************************************************************/
+// File '.nset' = the histogram Nvect of a dataset, so that it doesn't have to be read and counted again at each run.
+// Header of 40 bytes, then one record per different state (all the integers are little-endian):
+//   magic "NSET" | version (uint32) | n (uint32) | bit order (uint32) | N (uint64) | nb of states (uint64) | checksum (uint64)
+//   record = state on ceil(n/8) bytes, followed by its count (uint64);  the states are ordered as in Nvect.
+// Bit order 0:  bit 'i' of a state is the character 'n-1-i' of the line of the text file (first character = highest bit).
+// The checksum is the 64-bit FNV-1a hash of the records, followed by the bytes 8 to 31 of the header (n, bit order, N, nb of states).
+const char Nset_magic[4] = {'N', 'S', 'E', 'T'};
+const uint32_t Nset_version = 2;
+const size_t Nset_header_size = 40;
+
+uint64_t Nset_Checksum(const char* data, size_t size, uint64_t h = 14695981039346656037ULL)
+{
+  for (size_t i = 0; i < size; i++)  {   h = (h ^ (unsigned char) data[i]) * 1099511628211ULL;   }
+  return h;
+}
+
+bool Is_Nset_file(string datafilename)
+  {   return datafilename.size() > 5 && datafilename.compare(datafilename.size() - 5, 5, ".nset") == 0;   }
+
+template <typename T>
+inline void Put_Bytes(char* p, T x, size_t Nbytes = sizeof(T))
+  {   for (size_t b = 0; b < Nbytes; b++)  {   p[b] = (char) ((x >> (8*b)) & 0xFF);   }   }
+
+template <typename T>
+inline T Get_Bytes(const char* p, size_t Nbytes = sizeof(T))
+{
+  T x = 0;
+  for (size_t b = 0; b < Nbytes; b++)  {   x |= ((T) (unsigned char) p[b]) << (8*b);   }
+  return x;
+}
+
+/**************    WRITE Nset in a binary file    ****************************/
+// The records are written one by one (the histogram doesn't have to be in memory), then the header is written at the beginning of the file:
+struct Nset_Stream
+{
+  ofstream file;
+  string filename;
+  unsigned int n = 0;
+  size_t Nbytes = 0;              // nb of bytes of a state
+  uint64_t N = 0, Nset = 0;
+  uint64_t checksum = 14695981039346656037ULL;   // FNV-1a of the records written so far
+  vector<char> Buffer;
+};
+
+const size_t Nset_buffer_size = 1 << 20;
+
+void Flush_Nset(Nset_Stream& S)
+{
+  S.checksum = Nset_Checksum(S.Buffer.data(), S.Buffer.size(), S.checksum);
+  S.file.write(S.Buffer.data(), S.Buffer.size());
+  S.Buffer.clear();
+}
+
+bool Open_Nset(Nset_Stream& S, string nset_filename, unsigned int n)
+{
+  S.filename = nset_filename;
+  S.n = n;
+  S.Nbytes = (n + 7) / 8;
+  S.Buffer.reserve(Nset_buffer_size + S.Nbytes + 8);
+
+  S.file.open(nset_filename.c_str(), ios::out | ios::binary);
+  if (!S.file.is_open())
+  {
+    cout << endl << "--->> Unable to write the file: \"" << nset_filename << "\"" << endl << endl;
+    return false;
+  }
+  vector<char> Header(Nset_header_size, 0);   // written at the end
+  S.file.write(Header.data(), Header.size());
+  return true;
+}
+
+inline void Write_Nset(Nset_Stream& S, __int128_t state, uint64_t count)
+{
+  size_t pos = S.Buffer.size();
+  S.Buffer.resize(pos + S.Nbytes + 8);
+  Put_Bytes<unsigned __int128>(S.Buffer.data() + pos, (unsigned __int128) state, S.Nbytes);
+  Put_Bytes<uint64_t>(S.Buffer.data() + pos + S.Nbytes, count);
+
+  S.N += count;
+  S.Nset++;
+  if (S.Buffer.size() >= Nset_buffer_size)  {   Flush_Nset(S);   }
+}
+
+bool Close_Nset(Nset_Stream& S)
+{
+  Flush_Nset(S);
+
+  char h[Nset_header_size];
+  memcpy(h, Nset_magic, 4);
+  Put_Bytes<uint32_t>(h + 4, Nset_version);
+  Put_Bytes<uint32_t>(h + 8, S.n);
+  Put_Bytes<uint32_t>(h + 12, 0);   // bit order
+  Put_Bytes<uint64_t>(h + 16, S.N);
+  Put_Bytes<uint64_t>(h + 24, S.Nset);
+  Put_Bytes<uint64_t>(h + 32, Nset_Checksum(h + 8, 24, S.checksum));
+
+  S.file.seekp(0);
+  S.file.write(h, Nset_header_size);
+  S.file.close();
+
+  if (!S.file)
+  {
+    cout << endl << "--->> Unable to write the file: \"" << S.filename << "\"" << endl << endl;
+    return false;
+  }
+  cout << endl << "--->> Histogram of the data written in the file: \"" << S.filename << "\"" << endl;
+  cout << "\t n = " << S.n << ", \t N = " << S.N << ", \t Nset.size() = " << S.Nset << endl << endl;
+  return true;
+}
+
+// The counts of 'Nvect' must add up to 'N' (number of datapoints written in the header):  otherwise nothing is written.
+bool write_Nset_file(string nset_filename, const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N)
+{
+  uint64_t N_sum = 0;
+  for (auto& it : Nvect)  {   N_sum += it.second;   }
+  if (N_sum != N)
+  {
+    cout << endl << "--->> The counts of the histogram add up to " << N_sum << " datapoints, instead of N = " << N << ":  the file \"" << nset_filename << "\" is not written." << endl << endl;
+    return false;
+  }
+
+  Nset_Stream S;
+  if (!Open_Nset(S, nset_filename, n))  {   return false;   }
+
+  for (auto& it : Nvect)  {   Write_Nset(S, it.first, it.second);   }
+  return Close_Nset(S);
+}
+
+/**************    READ Nset from a binary file    ***************************/
+// The number of variables 'r' must be the one of the file;  N = 0 if the file can't be used.
+vector<pair<__int128_t, uint64_t>> read_Nset_file(string nset_filename, uint64_t *N, unsigned int r)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << endl << "--->> Read the histogram of the data: \"" << nset_filename << "\"" << endl;
+
+  (*N) = 0;
+  vector<pair<__int128_t, uint64_t>> Nvect;
+
+  ifstream file(nset_filename.c_str(), ios::in | ios::binary | ios::ate);
+  if (!file.is_open())
+  {
+    cout << endl << "--->> Unable to open file: Check datafilename and location." << endl << endl;
+    return Nvect;
+  }
+  uint64_t file_size = (uint64_t) file.tellg();
+  file.seekg(0);
+
+  char h[Nset_header_size];
+  file.read(h, Nset_header_size);
+  if (file.gcount() != (streamsize) Nset_header_size || memcmp(h, Nset_magic, 4) != 0 || Get_Bytes<uint32_t>(h + 4) != Nset_version || Get_Bytes<uint32_t>(h + 12) != 0)
+  {
+    cout << endl << "--->> The file is not a '.nset' file of this version:  Terminate." << endl << endl;
+    return Nvect;
+  }
+
+  unsigned int n = Get_Bytes<uint32_t>(h + 8);
+  uint64_t N_file = Get_Bytes<uint64_t>(h + 16), Nset = Get_Bytes<uint64_t>(h + 24);
+  if (n != r)
+  {
+    cout << endl << "--->> The file contains n = " << n << " variables, instead of n = " << r << ":  Terminate." << endl << endl;
+    return Nvect;
+  }
+
+  // The number of states of the header is checked against the size of the file before the records are read:
+  size_t Nbytes = (n + 7) / 8, record = Nbytes + 8;
+  if (Nset > (file_size - Nset_header_size) / record || file_size != Nset_header_size + Nset * record)
+  {
+    cout << endl << "--->> The file is truncated or corrupted (wrong size):  Terminate." << endl << endl;
+    return Nvect;
+  }
+
+  vector<char> Buffer(Nset * record);
+  file.read(Buffer.data(), Buffer.size());
+  file.close();
+
+  if (file.gcount() != (streamsize) Buffer.size() || Nset_Checksum(h + 8, 24, Nset_Checksum(Buffer.data(), Buffer.size())) != Get_Bytes<uint64_t>(h + 32))
+  {
+    cout << endl << "--->> The file is truncated or corrupted (wrong checksum):  Terminate." << endl << endl;
+    return Nvect;
+  }
+
+  // The states must have no bit above the n variables, and be strictly increasing in the order of the histograms ('Sort_States'):
+  // for n < 128 it is the order of the states as unsigned integers (the highest bit, sign of a '__int128_t', is only used with n = 128).
+  unsigned __int128 Out_of_range = (n < 128)? ~((((unsigned __int128) 1) << n) - 1) : 0;
+  uint64_t N_sum = 0;
+  Nvect.resize(Nset);
+  const char* p = Buffer.data();
+  for (size_t i = 0; i < Nset; i++, p += record)
+  {
+    unsigned __int128 state = Get_Bytes<unsigned __int128>(p, Nbytes);
+    if ((state & Out_of_range) || (i > 0 && (__int128_t) state <= Nvect[i-1].first))
+    {
+      cout << endl << "--->> The file is corrupted (states not increasing, or with more than n bits):  Terminate." << endl << endl;
+      return vector<pair<__int128_t, uint64_t>>();
+    }
+    Nvect[i].first = (__int128_t) state;
+    Nvect[i].second = Get_Bytes<uint64_t>(p + Nbytes);
+    N_sum += Nvect[i].second;
+  }
+
+  if (N_sum != N_file)
+  {
+    cout << endl << "--->> The counts of the file are not consistent with its number of datapoints:  Terminate." << endl << endl;
+    return vector<pair<__int128_t, uint64_t>>();
+  }
+  (*N) = N_file;
+
+  cout << endl << "--->> File has been read successfully:" << endl;
+  cout << "\t Data size, N = " << (*N) << endl;
+  cout << "\t Number of different states, Nset.size() = " << Nvect.size() << endl << endl;
+
+  auto end = chrono::system_clock::now();  
+  chrono::duration<double>  elapsed = end - start;
+  cout << endl << "Elapsed time (in s): " << elapsed.count() << endl << endl;  
+
+  return Nvect;
+}
+
+/**************    TRANSFORM Nset to a NEW BASIS    **************************/
+// The original order of the datapoints is not in the '.nset' file: the dataset in the new basis is written as a '.nset' file.
+void convert_Nset_to_NewBasis(const vector<pair<__int128_t, uint64_t>>& Nvect, string output_datafile, unsigned int n, uint64_t N, vector<Operator128> BestBasis_vect, unsigned int Nthreads = 1)
+{
+  vector<pair<__int128_t, uint64_t>> Kvect = build_Kvect(Nvect, BestBasis_vect, n, Nthreads);
+
+  if (write_Nset_file(output_datafile + "_inBestBasis.nset", Kvect, n, N))
+  {
+    cout << "Operators are ordered from Right to Left: i.e. " << endl; 
+    cout << " \t - the first basis operator corresponds to the rightmost bit (lowest bit)" << endl;
+    cout << " \t - the n-th basis operator corresponds to the leftmost bit (highest bit) " << endl;
+  }
+}
+
+/******************************************************************************/
+/*****************   OUT-of-CORE READING of LARGE DATAFILES   *****************/
+/******************************************************************************/
+// For datafiles whose histogram doesn't fit in memory ('--ooc-mb M'):
+//   -- the file is read by segments, whose states take at most about 'M' MB (one segment = one sorted run of the histogram);
+//   -- the lines of a segment are read in parallel, in pieces; successive identical states are collapsed on the fly (run-length),
+//      and a piece whose states are already increasing is not sorted (e.g. 'Big5PT.sorted' or 'MNIST11.sorted');
+//   -- the pieces are merged in the run, which is written in a temporary file next to the datafile;
+//      a run that doesn't start before the end of the previous one is appended to the same file (a sorted datafile gives a single run);
+//   -- the runs are then merged (k-way merge) in the final histogram, with 64-bit counts, written in Nvect or in a '.nset' file.
+void Sort_States(vector<pair<__int128_t, uint64_t>>& A);
+void RunLength_States(vector<pair<__int128_t, uint64_t>>& A);
+vector<pair<__int128_t, uint64_t>> Merge_Sorted_States(vector<vector<pair<__int128_t, uint64_t>>>& Sorted, unsigned int Nthreads = 1);
+
+struct Run_File
+{
+  string filename;
+  uint64_t Nrecords = 0;
+  __int128_t last = 0;     // last state of the run
+};
+
+const size_t Run_record_size = 24;        // state (16 bytes) + count (8 bytes)
+const size_t Run_buffer_min = 4096;       // smallest number of records read at once in each run during the merge
+
+// Read the lines of [begin, end), with the run-length of the successive identical states; returns false if the states are not increasing:
+bool RunLength_Lines(const char* begin, const char* end, unsigned int r, vector<pair<__int128_t, uint64_t>>& Run)
+{
+  bool sorted = true;
+  const char* line = begin;
+
+  while (line < end)
+  {
+    const char* eol = (const char*) memchr(line, '\n', end - line);
+    if (eol == nullptr)  {   eol = end;   }
+
+    __int128_t state = Parse_State(line, eol - line, r);
+    if (!Run.empty() && Run.back().first == state)  {   Run.back().second++;   }
+    else
+    {
+      if (!Run.empty() && state < Run.back().first)  {   sorted = false;   }
+      Run.push_back(pair<__int128_t, uint64_t>(state, 1));
+    }
+    line = eol + 1;
+  }
+  return sorted;
+}
+
+void Write_Run(ofstream& file, const vector<pair<__int128_t, uint64_t>>& Run)
+{
+  vector<char> Buffer(Run.size() * Run_record_size);
+  char* p = Buffer.data();
+  for (auto& it : Run)
+  {
+    Put_Bytes<unsigned __int128>(p, (unsigned __int128) it.first, 16);
+    Put_Bytes<uint64_t>(p + 16, it.second);
+    p += Run_record_size;
+  }
+  file.write(Buffer.data(), Buffer.size());
+}
+
+// Reader of a run during the k-way merge:
+struct Run_Reader
+{
+  ifstream file;
+  uint64_t Nleft = 0;      // nb of records not read yet in the file
+  vector<char> Buffer;
+  size_t pos = 0, size = 0;
+  __int128_t state = 0;
+  uint64_t count = 0;
+};
+
+bool Next_Record(Run_Reader& R, size_t Nrecords_buffer)
+{
+  if (R.pos == R.size)
+  {
+    if (R.Nleft == 0)  {   return false;   }
+    size_t Nread = (R.Nleft < Nrecords_buffer)? R.Nleft : Nrecords_buffer;
+    R.Buffer.resize(Nread * Run_record_size);
+    R.file.read(R.Buffer.data(), R.Buffer.size());
+    R.Nleft -= Nread;
+    R.pos = 0;
+    R.size = R.Buffer.size();
+  }
+  R.state = (__int128_t) Get_Bytes<unsigned __int128>(R.Buffer.data() + R.pos, 16);
+  R.count = Get_Bytes<uint64_t>(R.Buffer.data() + R.pos + 16);
+  R.pos += Run_record_size;
+  return true;
+}
+
+// Histogram of the datafile with at most about 'memory_MB' MB of states in memory:
+// 'Emit(state, count)' is called for each different state, by increasing value of the state;  returns N (0 if the file can't be read).
+uint64_t Histogram_OutOfCore(string datafilename, unsigned int r, double memory_MB, unsigned int Nthreads, const function<void(__int128_t, uint64_t)>& Emit)
+{
+  if (Nthreads < 1)  {   Nthreads = 1;   }
+
+  int fd = open(datafilename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0)
+  {
+    if (fd >= 0)  {   close(fd);   }
+    cout << endl << "--->> Unable to open file: Check datafilename and location." << endl << endl;
+    return 0;
+  }
+  size_t size = file_stat.st_size;
+  if (size == 0)  {   close(fd);   return 0;   }
+
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    cout << endl << "--->> Unable to map the file in memory." << endl;
+    return 0;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const char* Data = (const char*) map;
+
+  // Size of a segment: a line of (r+1) characters gives at most one pair of 32 bytes, and the merge of the pieces needs twice the memory:
+  size_t Nstates_max = (size_t) (memory_MB * 1024. * 1024. / (2. * sizeof(pair<__int128_t, uint64_t>)));
+  if (Nstates_max < Run_buffer_min)  {   Nstates_max = Run_buffer_min;   }
+  size_t Segment_size = Nstates_max * (r + 1);
+
+  uint64_t N = 0;
+  vector<Run_File> Runs;
+  vector<pair<__int128_t, uint64_t>> Run;     // run of the current segment
+  ofstream run_file;
+  string run_prefix = datafilename + ".run" + to_string(getpid()) + "_";
+
+  for (size_t seg_begin = 0; seg_begin < size; )
+  {
+    // End of the segment (end of a line):
+    size_t seg_end = (size - seg_begin > Segment_size)? seg_begin + Segment_size : size;
+    while (seg_end < size && Data[seg_end - 1] != '\n')  {   seg_end++;   }
+
+    // Pieces of complete lines, read in parallel:
+    vector<size_t> cut(Nthreads + 1, seg_end);
+    cut[0] = seg_begin;
+    for (unsigned int p = 1; p < Nthreads; p++)
+    {
+      size_t c = seg_begin + ((seg_end - seg_begin) * p) / Nthreads;
+      if (c < cut[p-1])  {   c = cut[p-1];   }
+      while (c > seg_begin && c < seg_end && Data[c - 1] != '\n')  {   c++;   }
+      cut[p] = c;
+    }
+
+    vector<vector<pair<__int128_t, uint64_t>>> Pieces(Nthreads);
+    Parallel_Ranges(Nthreads, Nthreads, Nthreads, [&](uint64_t, uint64_t p, uint64_t)
+    {
+      if (!RunLength_Lines(Data + cut[p], Data + cut[p+1], r, Pieces[p]))
+        {   Sort_States(Pieces[p]);   }
+      RunLength_States(Pieces[p]);
+    });
+    for (auto& P : Pieces)
+      {   for (auto& it : P)  {   N += it.second;   }   }
+
+    Run = Merge_Sorted_States(Pieces, Nthreads);
+    madvise((void*) (Data + (seg_begin / 4096) * 4096), seg_end - (seg_begin / 4096) * 4096, MADV_DONTNEED);   // pages already read
+    seg_begin = seg_end;
+
+    if (seg_begin == size && Runs.empty())  {   break;   }   // a single segment: no run file
+
+    // Write the run (appended to the previous run file if it doesn't start before its end):
+    if (Run.empty())  {   continue;   }
+    if (Runs.empty() || Run.front().first < Runs.back().last)
+    {
+      if (run_file.is_open())  {   run_file.close();   }
+      Run_File RF;
+      RF.filename = run_prefix + to_string(Runs.size()) + ".tmp";
+      Runs.push_back(RF);
+      run_file.open(RF.filename.c_str(), ios::out | ios::binary);
+      if (!run_file.is_open())
+      {
+        cout << endl << "--->> Unable to write the temporary file: \"" << RF.filename << "\"" << endl << endl;
+        munmap(map, size);
+        for (auto& R : Runs)  {   remove(R.filename.c_str());   }
+        return 0;
+      }
+    }
+    Write_Run(run_file, Run);
+    Runs.back().Nrecords += Run.size();
+    Runs.back().last = Run.back().first;
+    vector<pair<__int128_t, uint64_t>>().swap(Run);
+  }
+  if (run_file.is_open())  {   run_file.close();   }
+  munmap(map, size);
+
+  if (Runs.empty())   // the histogram fits in memory
+  {
+    for (auto& it : Run)  {   Emit(it.first, it.second);   }
+    return N;
+  }
+
+  cout << "\t Number of sorted runs written in temporary files: " << Runs.size() << endl;
+
+  // k-way merge of the runs:
+  size_t Nrecords_buffer = (size_t) (memory_MB * 1024. * 1024. / (Run_record_size * Runs.size()));
+  if (Nrecords_buffer < Run_buffer_min)  {   Nrecords_buffer = Run_buffer_min;   }
+
+  vector<Run_Reader> Reader(Runs.size());
+  auto later = [&Reader](size_t a, size_t b)  {   return Reader[a].state > Reader[b].state;   };
+  priority_queue<size_t, vector<size_t>, decltype(later)> Heap(later);
+
+  for (size_t k = 0; k < Runs.size(); k++)
+  {
+    Reader[k].file.open(Runs[k].filename.c_str(), ios::in | ios::binary);
+    Reader[k].Nleft = Runs[k].Nrecords;
+    if (Next_Record(Reader[k], Nrecords_buffer))  {   Heap.push(k);   }
+  }
+
+  bool first = true;
+  __int128_t state = 0;
+  uint64_t count = 0;
+  while (!Heap.empty())
+  {
+    size_t k = Heap.top();  Heap.pop();
+
+    if (!first && Reader[k].state == state)  {   count += Reader[k].count;   }
+    else
+    {
+      if (!first)  {   Emit(state, count);   }
+      state = Reader[k].state;  count = Reader[k].count;  first = false;
+    }
+
+    if (Next_Record(Reader[k], Nrecords_buffer))  {   Heap.push(k);   }
+  }
+  if (!first)  {   Emit(state, count);   }
+
+  for (size_t k = 0; k < Runs.size(); k++)
+  {
+    Reader[k].file.close();
+    remove(Runs[k].filename.c_str());
+  }
+  return N;
+}
+
+/**************    READ DATA and STORE them in Nset (out-of-core)    **********/
+vector<pair<__int128_t, uint64_t>> read_datafile128_OutOfCore(string datafilename, uint64_t *N, unsigned int r, double memory_MB, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << endl << "--->> Read the datafile: \"" << datafilename << "\", \t Build Nset (out-of-core, " << memory_MB << " MB)..." << endl;
+  cout << "\t Number of variables to read: n = " << r << endl;
 
+  vector<pair<__int128_t, uint64_t>> Nvect;
+  (*N) = Histogram_OutOfCore(datafilename, r, memory_MB, Nthreads, [&](__int128_t state, uint64_t count)
+    {   Nvect.push_back(pair<__int128_t, uint64_t>(state, count));   });
+
+  if ((*N) == 0) 
+    { 
+    cout << endl << "--->> Failure to read the file, or file is empty:  Terminate." << endl << endl;
+    }
+  else
+    {
+    cout << endl << "--->> File has been read successfully:" << endl;
+    cout << "\t Data size, N = " << (*N) << endl;
+    cout << "\t Number of different states, Nset.size() = " << Nvect.size() << endl << endl;
+    }
+
+  auto end = chrono::system_clock::now();  
+  chrono::duration<double>  elapsed = end - start;
+  cout << endl << "Elapsed time (in s): " << elapsed.count() << endl << endl;  
+
+  return Nvect;
+}
+
+/**************    WRITE the histogram of the data in a '.nset' file (out-of-core)    ***/
+// The histogram is written directly in the file, without being kept in memory (64-bit counts):
+bool write_Nset_OutOfCore(string datafilename, string nset_filename, unsigned int r, double memory_MB, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << endl << "--->> Read the datafile: \"" << datafilename << "\", \t Write its histogram (out-of-core, " << memory_MB << " MB)..." << endl;
+  cout << "\t Number of variables to read: n = " << r << endl;
+
+  Nset_Stream S;
+  if (!Open_Nset(S, nset_filename, r))  {   return false;   }
+
+  uint64_t N = Histogram_OutOfCore(datafilename, r, memory_MB, Nthreads, [&](__int128_t state, uint64_t count)
+    {   Write_Nset(S, state, count);   });
+
+  bool ok = Close_Nset(S);
+  if (N == 0)
+  {
+    cout << endl << "--->> Failure to read the file, or file is empty:  Terminate." << endl << endl;
+    remove(nset_filename.c_str());
+    return false;
+  }
+
+  auto end = chrono::system_clock::now();  
+  chrono::duration<double>  elapsed = end - start;
+  cout << "Elapsed time (in s): " << elapsed.count() << endl << endl;  
+
+  return ok;
+}
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h> // for the parity-count kernels
+#endif
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+
+const size_t Rows_block = 8;   // the arrays are padded to a multiple of 8 rows (one 512-bit register of counts)
+
+/******************************************************************************/
+/*******************     BUILD the ROW-MAJOR DATA (SoA)    ********************/
+/******************************************************************************/
+// Name of the kernel selected at compilation (-march=native):
+string Rows_Kernel()
+{
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+  return "AVX-512 (8 rows per instruction, hardware popcount)";
+#elif defined(__AVX512F__)
+  return "AVX-512 (8 rows per instruction)";
+#elif defined(__AVX2__)
+  return "AVX2 (4 rows per instruction)";
+#else
+  return "scalar";
+#endif
+}
+
+// Complexity = O(|Nset|),  Memory = 16 or 24 bytes per different state
+Rows128 Build_Rows(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Build the row-major copy of the data (one array for the states, one for the counts):" << endl;
+
+  Rows128 Data;
+  Data.n = n;
+  Data.N = N;
+  Data.Nrows = Nvect.size();
+
+  size_t Nrows_padded = ((Nvect.size() + Rows_block - 1) / Rows_block) * Rows_block;
+  Data.Lo.assign(Nrows_padded, 0);
+  Data.Count.assign(Nrows_padded, 0);
+
+  for (auto& it : Nvect)
+  {
+    if ((uint64_t) (((unsigned __int128) it.first) >> 64))  {   Data.wide = true;   break;   }
+  }
+  if (Data.wide)  {   Data.Hi.assign(Nrows_padded, 0);   }
+
+  for (size_t r = 0; r < Nvect.size(); r++)
+  {
+    Data.Lo[r] = (uint64_t) Nvect[r].first;
+    if (Data.wide)  {   Data.Hi[r] = (uint64_t) (((unsigned __int128) Nvect[r].first) >> 64);   }
+    Data.Count[r] = Nvect[r].second;
+  }
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+
+  cout << "\t Number of rows = " << Data.Nrows << ", \t Kernel = " << Rows_Kernel();
+  cout << ", \t Memory = " << ((Data.Lo.size() + Data.Hi.size() + Data.Count.size()) * sizeof(uint64_t)) / 1024. / 1024. << " MB" << endl;
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return Data;
+}
+
+/******************************************************************************/
+/**********************     PARITY-COUNT KERNELS    ***************************/
+/******************************************************************************/
+// K1(Op) = sum_r Count[r] * parity(state_r & Op), over the rows [r_start, r_end) (multiples of 8):
+// the parity of (state & Op) is the parity of  (Lo & Op_lo) ^ (Hi & Op_hi),
+// and the count of the row is added when this parity is odd (masked add, no branch).
+// The highest words are only read when the states and the operator both use them ('Wide' = true).
+#if defined(__AVX512F__)
+// Mask of the lanes of x with an odd number of bits:
+inline __mmask8 Odd_Mask(__m512i x)
+{
+#if defined(__AVX512VPOPCNTDQ__)
+  x = _mm512_popcnt_epi64(x);
+#else
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 32));
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 16));
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 8));
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 4));
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 2));
+  x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 1));
+#endif
+  return _mm512_test_epi64_mask(x, _mm512_set1_epi64(1));
+}
+
+template <bool Wide>
+uint64_t K1_Kernel(const Rows128& Data, uint64_t Op_lo, uint64_t Op_hi, size_t r_start, size_t r_end)
+{
+  const uint64_t* Lo = Data.Lo.data();
+  const uint64_t* Hi = Data.Hi.data();
+  const uint64_t* Count = Data.Count.data();
+  __m512i op_lo = _mm512_set1_epi64((long long) Op_lo), op_hi = _mm512_set1_epi64((long long) Op_hi);
+  __m512i acc = _mm512_setzero_si512();
+
+  for (size_t r = r_start; r < r_end; r += 8)
+  {
+    __m512i x = _mm512_and_si512(_mm512_load_si512((const void*) (Lo + r)), op_lo);
+    if (Wide)  {   x = _mm512_xor_si512(x, _mm512_and_si512(_mm512_load_si512((const void*) (Hi + r)), op_hi));   }
+    acc = _mm512_mask_add_epi64(acc, Odd_Mask(x), acc, _mm512_load_si512((const void*) (Count + r)));
+  }
+  return (uint64_t) _mm512_reduce_add_epi64(acc);
+}
+#elif defined(__AVX2__)
+// Lanes of x with an odd number of bits set to all 1's, the others to 0 (no 64-bit popcount in AVX2: the bits are folded):
+inline __m256i Odd_Mask(__m256i x)
+{
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 32));
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 16));
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 8));
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 4));
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 2));
+  x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 1));
+  return _mm256_sub_epi64(_mm256_setzero_si256(), _mm256_and_si256(x, _mm256_set1_epi64x(1)));
+}
+
+template <bool Wide>
+uint64_t K1_Kernel(const Rows128& Data, uint64_t Op_lo, uint64_t Op_hi, size_t r_start, size_t r_end)
+{
+  const uint64_t* Lo = Data.Lo.data();
+  const uint64_t* Hi = Data.Hi.data();
+  const uint64_t* Count = Data.Count.data();
+  __m256i op_lo = _mm256_set1_epi64x((long long) Op_lo), op_hi = _mm256_set1_epi64x((long long) Op_hi);
+  __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+
+  for (size_t r = r_start; r < r_end; r += 8)   // two independent accumulators of 4 rows
+  {
+    __m256i x0 = _mm256_and_si256(_mm256_load_si256((const __m256i*) (Lo + r)), op_lo);
+    __m256i x1 = _mm256_and_si256(_mm256_load_si256((const __m256i*) (Lo + r + 4)), op_lo);
+    if (Wide)
+    {
+      x0 = _mm256_xor_si256(x0, _mm256_and_si256(_mm256_load_si256((const __m256i*) (Hi + r)), op_hi));
+      x1 = _mm256_xor_si256(x1, _mm256_and_si256(_mm256_load_si256((const __m256i*) (Hi + r + 4)), op_hi));
+    }
+    acc0 = _mm256_add_epi64(acc0, _mm256_and_si256(Odd_Mask(x0), _mm256_load_si256((const __m256i*) (Count + r))));
+    acc1 = _mm256_add_epi64(acc1, _mm256_and_si256(Odd_Mask(x1), _mm256_load_si256((const __m256i*) (Count + r + 4))));
+  }
+
+  uint64_t sum[4];
+  _mm256_storeu_si256((__m256i*) sum, _mm256_add_epi64(acc0, acc1));
+  return sum[0] + sum[1] + sum[2] + sum[3];
+}
+#else
+template <bool Wide>
+uint64_t K1_Kernel(const Rows128& Data, uint64_t Op_lo, uint64_t Op_hi, size_t r_start, size_t r_end)
+{
+  uint64_t K1 = 0;
+  for (size_t r = r_start; r < r_end; r++)
+  {
+    uint64_t x = Data.Lo[r] & Op_lo;
+    if (Wide)  {   x ^= Data.Hi[r] & Op_hi;   }
+    K1 += Data.Count[r] & (0 - (uint64_t) __builtin_parityll(x));
+  }
+  return K1;
+}
+#endif
+
+// Number of times an operator is equal to 1 in the dataset:  Complexity = O(|Nset|), one pass over 16 (or 24) bytes per state
+uint64_t K1_Op(const Rows128& Data, __int128_t Op)
+{
+  uint64_t Op_lo = (uint64_t) Op, Op_hi = (uint64_t) (((unsigned __int128) Op) >> 64);
+  size_t r_end = Data.Lo.size();
+  return (Data.wide && Op_hi)? K1_Kernel<true>(Data, Op_lo, Op_hi, 0, r_end) : K1_Kernel<false>(Data, Op_lo, Op_hi, 0, r_end);
+}
+
+// Values K1 of a block of 'B' operators Op[0, B), in a single pass over the data:
+// each tile of 'Rows_tile' rows is read once from the memory, then used by the 'B' operators while it is in the L1 cache.
+// Memory traffic = one pass over the data per block of operators, instead of one pass per operator.
+void K1_Block(const Rows128& Data, const __int128_t* Op, size_t B, uint64_t* K1)
+{
+  for (size_t b = 0; b < B; b++)  {   K1[b] = 0;   }
+
+  for (size_t r_start = 0; r_start < Data.Lo.size(); r_start += Rows_tile)
+  {
+    size_t r_end = (r_start + Rows_tile < Data.Lo.size())? r_start + Rows_tile : Data.Lo.size();
+    for (size_t b = 0; b < B; b++)
+    {
+      uint64_t Op_lo = (uint64_t) Op[b], Op_hi = (uint64_t) (((unsigned __int128) Op[b]) >> 64);
+      K1[b] += (Data.wide && Op_hi)? K1_Kernel<true>(Data, Op_lo, Op_hi, r_start, r_end) : K1_Kernel<false>(Data, Op_lo, Op_hi, r_start, r_end);
+    }
+  }
+}
+
+// ******* Data averages are taken using ISING convention: ******************** /
+Operator128 Value_Op(__int128_t Op_bin, const Rows128& Data, double Nd)
+{
+  Operator128 Op;
+
+  Op.bin = Op_bin;
+  Op.k1 = K1_Op(Data, Op_bin);
+  Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+  return Op;
+}
@@ -0,0 +1,395 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+const __int128_t one128 = 1;
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+// Intersection of two lists of very different sizes: each row of the small list is searched in the large one by exponential search
+const uint64_t Sparse_gallop_ratio = 32;
+
+/******************************************************************************/
+/*****************     BUILD the SPARSE COLUMNS of the DATA    ****************/
+/******************************************************************************/
+// Fraction of 1's in the columns of the bit-sliced data:
+double Column_Density(const BitSliced& Data)
+{
+  uint64_t ones = 0;
+  for (unsigned int i = 0; i < Data.n; i++)
+  {
+    const uint64_t* col = Data.column(i);
+    for (uint64_t w = 0; w < Data.Nwords; w++)  {   ones += __builtin_popcountll(col[w]);   }
+  }
+  return (Data.n == 0 || Data.Nrows == 0)? 1. : ((double) ones) / (((double) Data.n) * Data.Nrows);
+}
+
+// Engine of the search on the bit-sliced data:  sparse columns with the 'sparse' engine, or with the 'bitsliced' engine
+// if the density of 1's is below 'Opt.sparse_density';  the row indices are on 32 bits, so the data must have less than 2^32 rows.
+bool Use_Sparse(const BitSliced& Data, Struct_Options Opt)
+{
+  if (Opt.engine == ENGINE_ROWS)  {   return false;   }
+  if (Data.Nrows >= (((uint64_t) 1) << 32))
+  {
+    if (Opt.engine == ENGINE_SPARSE)  {   cout << "--->> Too many rows for the sparse columns (2^32 or more): use the bit-sliced data instead." << endl << endl;   }
+    return false;
+  }
+  if (Opt.engine == ENGINE_SPARSE)  {   return true;   }
+
+  double density = Column_Density(Data);
+  if (density < Opt.sparse_density)
+    {   cout << "--->> Fraction of 1's in the columns = " << density << " < " << Opt.sparse_density << ": use the sparse columns." << endl;   }
+  return density < Opt.sparse_density;
+}
+
+// The rows of each column are extracted from its words (one 'ctz' per 1);  the counts of the rows from the bit-planes.
+// Complexity = O(n*Nwords + number of 1's),  Memory = 4 bytes per 1 (+ 8 bytes per row for the WEIGHTED layout)
+SparseColumns Build_Sparse(const BitSliced& Data, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Build the sparse columns of the data (sorted list of the rows in which each variable is 1):" << endl;
+
+  unsigned int n = Data.n;
+  SparseColumns Sparse;
+  Sparse.n = n;
+  Sparse.N = Data.N;
+  Sparse.Nrows = Data.Nrows;
+  Sparse.Start.assign(n + 1, 0);
+  Sparse.Weight.assign(n, 0);
+
+  if (Data.weighted)
+  {
+    Sparse.Count.assign(Data.Nrows, 0);
+    for (unsigned int b = 0; b < Data.Nplanes; b++)
+    {
+      const uint64_t* plane = Data.plane(b);
+      for (uint64_t w = 0; w < Data.Nwords; w++)
+      {
+        for (uint64_t x = plane[w]; x; x &= x - 1)  {   Sparse.Count[w * 64 + __builtin_ctzll(x)] += (((uint64_t) 1) << b);   }
+      }
+    }
+  }
+
+  vector<uint64_t> Size(n, 0);
+  Parallel_Ranges(n, Nthreads, n, [&](uint64_t, uint64_t i, uint64_t)
+  {
+    const uint64_t* col = Data.column(i);
+    for (uint64_t w = 0; w < Data.Nwords; w++)  {   Size[i] += __builtin_popcountll(col[w]);   }
+  });
+  for (unsigned int i = 0; i < n; i++)  {   Sparse.Start[i+1] = Sparse.Start[i] + Size[i];   }
+  Sparse.Row.resize(Sparse.Start[n]);
+
+  Parallel_Ranges(n, Nthreads, n, [&](uint64_t, uint64_t i, uint64_t)
+  {
+    const uint64_t* col = Data.column(i);
+    uint32_t* row = Sparse.Row.data() + Sparse.Start[i];
+    uint64_t weight = 0;
+    for (uint64_t w = 0; w < Data.Nwords; w++)
+    {
+      for (uint64_t x = col[w]; x; x &= x - 1)
+      {
+        uint64_t r = w * 64 + __builtin_ctzll(x);
+        *(row++) = (uint32_t) r;
+        weight += (Data.weighted)? Sparse.Count[r] : 1;
+      }
+    }
+    Sparse.Weight[i] = weight;
+  });
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+
+  cout << "\t Number of rows = " << Sparse.Nrows << ", \t Number of 1's = " << Sparse.Row.size();
+  cout << " (" << ((double) Sparse.Row.size()) / (((double) n) * Sparse.Nrows) << " per row and variable)";
+  cout << ", \t Memory = " << (Sparse.Row.size() * sizeof(uint32_t) + Sparse.Count.size() * sizeof(uint64_t)) / 1024. / 1024. << " MB" << endl;
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return Sparse;
+}
+
+/******************************************************************************/
+/**********************     XOR-and-COUNT KERNELS    **************************/
+/******************************************************************************/
+// First position of B[lo, nB) with B[pos] >= r (exponential search, then binary search):
+inline size_t Gallop(const uint32_t* B, size_t lo, size_t nB, uint32_t r)
+{
+  size_t step = 1, hi = lo;
+  while (hi < nB && B[hi] < r)  {   lo = hi + 1;   hi += step;   step *= 2;   }
+  if (hi > nB)  {   hi = nB;   }
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (B[mid] < r)  {   lo = mid + 1;   }  else  {   hi = mid;   }
+  }
+  return lo;
+}
+
+// Number of datapoints in the rows common to the sorted lists A and B:
+inline uint64_t Common_Weight(const SparseColumns& Data, const uint32_t* A, size_t nA, const uint32_t* B, size_t nB)
+{
+  if (nA > nB)  {   swap(A, B);   swap(nA, nB);   }
+
+  const uint64_t* Count = Data.Count.data();
+  bool weighted = !Data.Count.empty();
+  uint64_t common = 0;
+  size_t a = 0, b = 0;
+
+  if (nA * Sparse_gallop_ratio < nB)   // A is much smaller than B
+  {
+    for (; a < nA && b < nB; a++)
+    {
+      b = Gallop(B, b, nB, A[a]);
+      if (b < nB && B[b] == A[a])  {   common += (weighted)? Count[A[a]] : 1;   b++;   }
+    }
+    return common;
+  }
+
+  while (a < nA && b < nB)   // merge (the advance of a and b is computed without branches)
+  {
+    uint32_t ra = A[a], rb = B[b];
+    if (ra == rb)  {   common += (weighted)? Count[ra] : 1;   }
+    a += (ra <= rb);
+    b += (rb <= ra);
+  }
+  return common;
+}
+
+// Number of datapoints in the rows of the sorted list B that are set in the bitmap 'Mask' (one bit per row):
+// one lookup per row of B, without branch;  the bitmap of a list of rows is set and cleared in a time proportional to its size.
+inline uint64_t Common_Weight_Mask(const SparseColumns& Data, const uint64_t* Mask, const uint32_t* B, size_t nB)
+{
+  const uint64_t* Count = Data.Count.data();
+  uint64_t common = 0;
+
+  if (Data.Count.empty())
+  {
+    for (size_t b = 0; b < nB; b++)  {   common += (Mask[B[b] >> 6] >> (B[b] & 63)) & 1;   }
+  }
+  else
+  {
+    for (size_t b = 0; b < nB; b++)  {   common += Count[B[b]] & (0 - ((Mask[B[b] >> 6] >> (B[b] & 63)) & 1));   }
+  }
+  return common;
+}
+
+inline void Set_Mask(uint64_t* Mask, const uint32_t* A, size_t nA)
+{
+  for (size_t a = 0; a < nA; a++)  {   Mask[A[a] >> 6] |= ((uint64_t) 1) << (A[a] & 63);   }
+}
+
+inline void Clear_Mask(uint64_t* Mask, const uint32_t* A, size_t nA)
+{
+  for (size_t a = 0; a < nA; a++)  {   Mask[A[a] >> 6] = 0;   }
+}
+
+// P_out = rows in exactly one of the sorted lists A and B (A XOR B), also sorted;  returns the number of datapoints in P_out.
+inline uint64_t XOR_Rows(const SparseColumns& Data, const uint32_t* A, size_t nA, const uint32_t* B, size_t nB, vector<uint32_t>& P_out)
+{
+  P_out.clear();
+  const uint64_t* Count = Data.Count.data();
+  bool weighted = !Data.Count.empty();
+  uint64_t weight = 0;
+  size_t a = 0, b = 0;
+
+  while (a < nA && b < nB)
+  {
+    if (A[a] < B[b])  {   P_out.push_back(A[a++]);   }
+    else if (B[b] < A[a])  {   P_out.push_back(B[b++]);   }
+    else  {   a++;   b++;   }
+  }
+  P_out.insert(P_out.end(), A + a, A + nA);
+  P_out.insert(P_out.end(), B + b, B + nB);
+
+  for (auto& r : P_out)  {   weight += (weighted)? Count[r] : 1;   }
+  return weight;
+}
+
+// Number of times an operator is equal to 1 in the dataset:
+//   the rows of the k-1 first variables are XOR-ed (sorted lists), then  K1 = w(P) + w(col) - 2 w(P & col)  with the last one.
+// Complexity = O(number of 1's in the columns of the operator)
+uint64_t K1_Op(const SparseColumns& Data, __int128_t Op)
+{
+  vector<uint32_t> P, P_next;
+  uint64_t weight_P = 0;
+  int last = -1;
+
+  for (unsigned int i = 0; i < Data.n; i++)
+  {
+    if (!((Op >> i) & one128))  {   continue;   }
+    if (last >= 0)
+    {
+      weight_P = XOR_Rows(Data, P.data(), P.size(), Data.column(last), Data.size(last), P_next);
+      P.swap(P_next);
+    }
+    last = i;
+  }
+  if (last < 0)  {   return 0;   }
+
+  return weight_P + Data.Weight[last] - 2 * Common_Weight(Data, P.data(), P.size(), Data.column(last), Data.size(last));
+}
+
+// ******* Data averages are taken using ISING convention: ******************** /
+Operator128 Value_Op(__int128_t Op_bin, const SparseColumns& Data, double Nd)
+{
+  Operator128 Op;
+
+  Op.bin = Op_bin;
+  Op.k1 = K1_Op(Data, Op.bin);
+  Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+  return Op;
+}
+
+/******************************************************************************/
+/*************   All Operators with k bits on the SPARSE COLUMNS   ************/
+/******************************************************************************/
+string int_to_bstring(__int128_t bool_nb, unsigned int r);
+void int_to_digits(__int128_t bool_nb, unsigned int r);
+
+void Unrank_Combination(uint64_t rank, unsigned int n, unsigned int k, unsigned int* idx);
+
+Candidate128 Make_Candidate(__int128_t Op_bin, uint64_t k1);
+void Check_Floor(Struct_Floor& Floor, vector<Candidate128>& Buffer, Floor_Check& Check);
+
+// Depth-first enumeration of the combinations of k variables, as on the bit-sliced data (see 'AllOp_kbits_DFS' in 'BitSliced.cpp'):
+//   the stack of partial parities  P[d] = rows of (i_0 XOR ... XOR i_d)  is kept as sorted lists for d = 0, ..., k-2,
+//   and each new operator costs the intersection of P[k-2] with the column of its last variable:  the rows of P[k-2] are set
+//   in a bitmap over the rows, in which each row of the column is then looked up (time proportional to the size of the column).
+// K = k fixed at compilation (enumeration unrolled), or 0 (see 'Combination' in data.h)
+template <unsigned int K>
+void AllOp_kbits_Sparse_DFS(vector<Candidate128>& Buffer, vector<Candidate128>& Missed, const SparseColumns& Data, unsigned int k_run, double Nd, double Bias_LowerBound, Struct_Floor& Floor, const Cache_R0* R0, bool print, uint64_t start, uint64_t count)
+{
+  unsigned int n = Data.n;
+
+  Combination<K> C(n, k_run);                   // indices C.idx[] of the variables of the current operator
+  const unsigned int k = C.k();
+  __int128_t Op_prefix[(K > 0)? K : 128]{};     // Op_prefix[d] = operator with the variables i_0, ..., i_d
+  __int128_t Img_prefix[(K > 0)? K : 128]{};    // Img_prefix[d] = image in R0 of Op_prefix[d] (with a cache only)
+  vector<vector<uint32_t>> P(k);                // stack of partial parities (sorted lists of rows)
+  vector<uint64_t> weight_P(k, 0);              // number of datapoints in the rows of P[d]
+  vector<uint32_t> empty;                       // parity of the empty operator
+  vector<uint64_t> Mask((Data.Nrows + 63) / 64, 0);   // bitmap of the rows of P[k-2]
+
+  Unrank_Combination(start, n, k, C.idx);
+  const unsigned int* idx = C.idx;
+
+  int d0 = 0;   // first level of the stack to recompute
+  Floor_Check Check;   // checks of the buffer against the floor
+  uint64_t hits = 0;
+
+  while (count > 0)
+  {
+    // Update the stack from the level d0:
+    for (unsigned int l = (unsigned int) d0; l + 1 < k; l++)
+    {
+      const vector<uint32_t>& P_prev = (l == 0)? empty : P[l-1];
+      weight_P[l] = XOR_Rows(Data, P_prev.data(), P_prev.size(), Data.column(idx[l]), Data.size(idx[l]), P[l]);
+      Op_prefix[l] = ((l == 0)? 0 : Op_prefix[l-1]) | (one128 << idx[l]);
+      if (R0)  {   Img_prefix[l] = ((l == 0)? 0 : Img_prefix[l-1]) ^ R0->Row[idx[l]];   }
+    }
+
+    // All the choices of the last variable:
+    const vector<uint32_t>& P_last = (k == 1)? empty : P[k-2];
+    uint64_t weight_last = (k == 1)? 0 : weight_P[k-2];
+    __int128_t Op_last = (k == 1)? 0 : Op_prefix[k-2];
+    __int128_t Img_last = (k == 1)? 0 : Img_prefix[k-2];
+    Set_Mask(Mask.data(), P_last.data(), P_last.size());
+
+    for (unsigned int i = idx[k-1]; i < n && count > 0; i++, count--)
+    {
+      auto Compute_K1 = [&]() {   return weight_last + Data.Weight[i] - 2 * Common_Weight_Mask(Data, Mask.data(), Data.column(i), Data.size(i));   };
+      uint64_t K1 = (R0)? R0->K1(Img_last ^ R0->Row[i], Missed, &hits, Compute_K1) : Compute_K1();
+
+      __int128_t Op_bin = Op_last | (one128 << i);
+      double bias = fabs((((double) K1) / Nd) -0.5);  //fabs(p1-0.5);
+
+      if (bias > Bias_LowerBound && Floor.accept(K1)) { Buffer.push_back(Make_Candidate(Op_bin, K1)); }
+      if(print) {
+        cout << int_to_bstring(Op_bin, n) << "\t Bias = " << bias << "\t";
+        int_to_digits(Op_bin, n);
+      }
+    }
+
+    Clear_Mask(Mask.data(), P_last.data(), P_last.size());
+
+    if (Buffer.size() > Check.Nseen)  {   Check_Floor(Floor, Buffer, Check);   }
+
+    // Next combination of the k-1 first variables:
+    d0 = C.next_prefix();
+    if (d0 < 0)  {   break;   }
+  }
+
+  if (R0)  {   R0->Nhits += hits;   }
+}
+
+// Loop over all the operators with k bits, evaluated on the sparse columns: keep the ones with a bias larger than 'Bias_LowerBound'
+// and above the floor 'Floor' (raised during the loop);  the values already in the cache 'R0' (if any) are not recomputed
+// Returns the number of operators evaluated
+uint64_t AllOp_kbits_Parallel(OpSet128& OpSet, unsigned int n, unsigned int k, bool print, Struct_Options Opt, Struct_Floor& Floor, Cache_R0* Cache, const function<void(vector<Candidate128>&, vector<Candidate128>&, uint64_t, uint64_t)>& Eval_Range);
+
+uint64_t AllOp_kbits_Loop(OpSet128& OpSet, const SparseColumns& Data, unsigned int n, uint64_t N, unsigned int k, double Bias_LowerBound, Struct_Floor& Floor, Cache_R0* R0, bool print, Struct_Options Opt)
+{
+  double Nd = (double) N;
+  if (k == 0 || k > n)  {   return 0;   }
+
+  // Enumeration specialised for k (k <= K_unrolled):
+  return AllOp_kbits_Parallel(OpSet, n, k, print, Opt, Floor, R0, [&](vector<Candidate128>& Buffer, vector<Candidate128>& Missed, uint64_t start, uint64_t count)
+  {
+    switch (k)
+    {
+      case 1:   AllOp_kbits_Sparse_DFS<1>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 2:   AllOp_kbits_Sparse_DFS<2>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 3:   AllOp_kbits_Sparse_DFS<3>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 4:   AllOp_kbits_Sparse_DFS<4>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 5:   AllOp_kbits_Sparse_DFS<5>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      case 6:   AllOp_kbits_Sparse_DFS<6>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);  break;
+      default:  AllOp_kbits_Sparse_DFS<0>(Buffer, Missed, Data, k, Nd, Bias_LowerBound, Floor, R0, print, start, count);
+    }
+  });
+}
+
+/******************************************************************************/
+/*****************   CO-OCCURRENCE MATRIX of the SPARSE COLUMNS   *************/
+/******************************************************************************/
+void Print_Cooccurrence_Info(const Cooccurrence& M, chrono::duration<double> elapsed);
+
+// c_ii = w(col_i),  c_ij = w(col_i & col_j), with the bitmap of the column i:  Complexity = O(n * number of 1's)
+Cooccurrence Build_Cooccurrence(const SparseColumns& Data, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Co-occurrence matrix of the variables (intersections of the sparse columns):" << endl;
+
+  unsigned int n = Data.n;
+  Cooccurrence M;
+  M.n = n;
+  M.N = Data.N;
+  M.C.assign(((size_t) n) * n, 0);
+
+  Parallel_Ranges(n, Nthreads, n, [&](uint64_t, uint64_t i, uint64_t)
+  {
+    vector<uint64_t> Mask((Data.Nrows + 63) / 64, 0);
+    Set_Mask(Mask.data(), Data.column(i), Data.size(i));
+
+    M.C[i * n + i] = Data.Weight[i];
+    for (unsigned int j = i + 1; j < n; j++)
+      {   M.C[i * n + j] = M.C[((size_t) j) * n + i] = Common_Weight_Mask(Data, Mask.data(), Data.column(j), Data.size(j));   }
+  });
+
+  auto end = chrono::system_clock::now();
+  Print_Cooccurrence_Info(M, end - start);
+
+  return M;
+}
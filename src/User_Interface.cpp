@@ -1,8 +1,12 @@
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <cctype>
 
 using namespace std;
 
+#include "data.h"
+
 /******************************************************************************/
 /**************************  HELP MESSAGE  ************************************/
 /******************************************************************************/
@@ -49,8 +53,8 @@ void HELP_message()
     cout << "\tRun: ";
     cout << "   >> ./BestBasis.out [datafilename] [n] --exhaustive" << endl << endl;
 
-    cout << "Important: this is not recommended for dataset with more than n~20 variables" << endl;
-    cout << "For datasets with more than 25 variables, the program will automatically switch to option 4" << endl << endl;
+    cout << "Important: this is not recommended for dataset with more than n~34 variables (n~24 with the option '--no-wht')" << endl;
+    cout << "For datasets with more variables, the program will automatically switch to option 4" << endl << endl;
 
     cout << endl << "***************************************  OPTION 3  ****************************************";
     cout << endl << "**********************  Search among all operators up to order \'kmax\'  ********************";
@@ -82,6 +86,67 @@ void HELP_message()
     cout << "    >> ./BestBasis.out [datafilename] [n] --var-k [kmax]" << endl;
     cout << "\tto specify your choice of \'kmax\'" << endl; 
 
+    cout << endl << "***************************************  OPTIONS  *****************************************";
+    cout << endl << "*******************************************************************************************" << endl << endl;
+
+    cout << "The following options can be added at the end of the commands of options 1 to 4:" << endl << endl;
+
+    cout << "\t--engine [rows|bitsliced|sparse]" << endl;
+    cout << "\tchoice of the engine used to compute the bias of the operators (default: bitsliced):" << endl;
+    cout << "\t \t rows: \t\t one pass over all the different states of the data for each operator;" << endl;
+    cout << "\t \t \t\t the states are evaluated 4 or 8 at a time (AVX2 / AVX-512); best for small N or very large |Nset|;" << endl;
+    cout << "\t \t bitsliced: \t data stored as one bitvector per variable; an operator is computed" << endl;
+    cout << "\t \t \t\t with the XOR of the bitvectors of its variables;" << endl;
+    cout << "\t \t sparse: \t data stored as the sorted list of the rows in which each variable is 1; an operator" << endl;
+    cout << "\t \t \t\t is computed from the intersections of the lists of its variables; best when most values are 0." << endl;
+    cout << endl << "\t--sparse-density [D]" << endl;
+    cout << "\tfor the bitsliced engine: the sparse engine is used instead when the fraction of 1's in the columns of the data" << endl;
+    cout << "\t(in the current representation) is below D (default: 0.0078125 = 1/128; 0 = never)." << endl;
+
+    cout << endl << "\t--layout [auto|raw|weighted]" << endl;
+    cout << "\tlayout of the rows of the bitvectors for the bitsliced engine (default: auto):" << endl;
+    cout << "\t \t raw: \t\t one row per datapoint;" << endl;
+    cout << "\t \t weighted: \t one row per different state, the number of times each state" << endl;
+    cout << "\t \t \t\t appears in the data is stored in binary in additional bit-planes;" << endl;
+    cout << "\t \t auto: \t\t the cheapest of the two above, chosen from the ratio N / (nb of different states)." << endl;
+
+    cout << endl << "\t--threads [T]" << endl;
+    cout << "\tnumber of threads used to read the data and to compute the operators of order k >= 2 (default: 1);" << endl;
+    cout << "\tthe result doesn't depend on the number of threads." << endl;
+    cout << endl << "\t--mitm" << endl;
+    cout << "\tfor the bitsliced engine: compute the operators of order 4 as the XOR of two operators of order 2," << endl;
+    cout << "\twhose bitvectors are all computed once and kept in memory (meet-in-the-middle)." << endl;
+    cout << endl << "\t--no-wht" << endl;
+    cout << "\tfor the exhaustive search: compute the (2^n-1) operators one by one with the chosen engine," << endl;
+    cout << "\tinstead of all at once with the Walsh-Hadamard transform of the histogram of the data (in O(n 2^n))." << endl;
+    cout << endl << "\t--cache-mb [M]" << endl;
+    cout << "\tfor the search in varying representation: memory (in MB) of the cache of the values of the operators," << endl;
+    cout << "\tstored with their image in the original representation, and re-used in the next representations" << endl;
+    cout << "\t(default: 512; 0 = no cache)." << endl;
+    cout << endl << "\t--ooc-mb [M]" << endl;
+    cout << "\tout-of-core reading of datafiles larger than the memory: the file is read by segments of about M MB of states," << endl;
+    cout << "\twhose histograms are sorted and written in temporary files (runs) next to the datafile, then merged" << endl;
+    cout << "\t(already sorted datafiles are not sorted again); with '--write-nset', the histogram is written directly" << endl;
+    cout << "\tin the '.nset' file, with 64-bit counts (default: 0 = the datafile is read in memory)." << endl;
+    cout << endl << "\t--no-index" << endl;
+    cout << "\tsearch in fixed or varying representation with the bitsliced engine: by default, the bit-sliced data is written" << endl;
+    cout << "\tat the first run in an index file next to the datafile ('INPUT/[datafilename]_[content hash]_n[n]_[layout].bsi')," << endl;
+    cout << "\tthat is then mapped in memory by the next runs on the same data, instead of reading the datafile to build the data;" << endl;
+    cout << "\tthe index is found from the size, modification time and inode of the datafile, stored in its header; if they have" << endl;
+    cout << "\tchanged (datafile modified, touched or copied), the content of the datafile is hashed again (one pass over the file)." << endl;
+    cout << "\tThe datafile is still read at the end, to write the data in the best basis." << endl;
+    cout << "\tWith this option, the index is neither used nor written, and the datafile is not hashed." << endl;
+    cout << endl << "\t--write-nset" << endl;
+    cout << "\twrite the histogram of the data in the binary file 'INPUT/[datafilename without extension].nset', then stop;" << endl;
+    cout << "\ta datafile with the extension '.nset' is then read directly, without reading and counting the datapoints again." << endl;
+    cout << endl << "\t--no-pairs" << endl;
+    cout << "\tby default, the operators of order 2 are all obtained at once from the co-occurrence matrix of the variables" << endl;
+    cout << "\t(c_ij = number of datapoints with s_i = s_j = 1, then K1(s_i + s_j) = c_ii + c_jj - 2*c_ij);" << endl;
+    cout << "\twith this option, they are computed one by one on the data, as the operators of higher order." << endl;
+    cout << endl << "\t--write-pairs" << endl;
+    cout << "\twrite the co-occurrence matrix of the data in 'OUTPUT/[datafilename without extension]_Cooccurrence.dat'," << endl;
+    cout << "\tbefore the search." << endl;
+
     cout << endl << "*******************************************************************************************" << endl;
     cout << endl;
 }
@@ -91,7 +156,7 @@ void HELP_message()
 /************************** Read Arguments ************************************/
 /******************************************************************************/
 
-int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *n, unsigned int *k_max)
+int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *n, unsigned int *k_max, Struct_Options *Opt)
 {
     int flag_search = 1;   // 1 by default for the example
     // 1 = Exhaustive search
@@ -112,12 +177,6 @@ int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *
         HELP_message();
         return 0;        
     }
-    else if (argc > 5)
-    {
-        cout << endl << "ERROR: The number of arguments is not correct." << endl;
-        HELP_message();
-        return 0;
-    }
     else if (argc >= 3)
     {
         string input_datafile_buffer = argv[1];
@@ -126,43 +185,82 @@ int Read_argument(int argc, char *argv[], string *input_datafile, unsigned int *
         (*input_datafile) = input_datafile_buffer;
         (*n) = stoul(n_string_buffer);
 
-        if (argc == 3)
+        int i = 3;  // index of the next argument to read
+        string flag = (i < argc)? argv[i] : "";
+
+        if (flag == "--exhaustive") // Exhaustive search (the number of variables is checked after reading the options)
+            { i++;  flag_search = 1; }
+        else if (flag == "--fix-k" || flag == "--var-k") // Fixed or Varying basis search with default k_max
+        {
+            i++;
+            flag_search = (flag == "--fix-k")? 2 : 3;
+            if (i < argc && isdigit(argv[i][0]))
+                { (*k_max) = stoul(argv[i]);  i++; }
+        }
+        else 
         {
             if((*n)<15) // Exhaustive search
                 { flag_search = 1;  } 
             else     // Varying basis search with default k_max
                 { flag_search = 3;  } 
         }
-        else //if (argc == 4 || argc == 5)
+
+    /**********************     READ OPTIONS    **********************************/
+        while (i < argc)
         {
-            string flag = argv[3];
-            if (flag == "--exhaustive") // Exhaustive search
-            {
-                if ((*n) < 25) { flag_search = 1; }
-                else {  // Varying basis search with default k_max
-                    cout << "The Exhaustive Search is not recommended for dataset with more than n~20-25 variables." << endl;
-                    cout << "We Recommend to use the heuristic procedure instead." << endl;
-                    flag_search = 3;
-                }
-            }
-            else if (flag == "--fix-k") // Fixed basis search with default k_max
-            {
-                flag_search = 2;
-                if (argc == 5)
-                    { (*k_max) = stoul(argv[4]); }
-            }
-            else if (flag == "--var-k") // Varying basis search with default k_max
-            {
-                flag_search = 3;
-                if (argc == 5)
-                    { (*k_max) = stoul(argv[4]); }
-            }
+            string option = argv[i];
+            string value = (i+1 < argc)? argv[i+1] : "";
+
+            if (option == "--mitm")    // option without value
+                { (*Opt).mitm = true;   i++;   continue; }
+            else if (option == "--no-wht")    // option without value
+                { (*Opt).wht = false;   i++;   continue; }
+            else if (option == "--no-index")    // option without value
+                { (*Opt).index = false;   i++;   continue; }
+            else if (option == "--write-nset")    // option without value
+                { (*Opt).write_nset = true;   i++;   continue; }
+            else if (option == "--no-pairs")    // option without value
+                { (*Opt).pairs = false;   i++;   continue; }
+            else if (option == "--write-pairs")    // option without value
+                { (*Opt).write_pairs = true;   i++;   continue; }
+            else if (option == "--engine" && value == "rows")
+                { (*Opt).engine = ENGINE_ROWS; }
+            else if (option == "--engine" && value == "bitsliced")
+                { (*Opt).engine = ENGINE_BITSLICED; }
+            else if (option == "--engine" && value == "sparse")
+                { (*Opt).engine = ENGINE_SPARSE; }
+            else if (option == "--sparse-density" && value != "" && (isdigit(value[0]) || value[0] == '.'))
+                { (*Opt).sparse_density = stod(value); }
+            else if (option == "--threads" && value != "" && isdigit(value[0]) && stoul(value) > 0)
+                { (*Opt).threads = stoul(value); }
+            else if (option == "--cache-mb" && value != "" && isdigit(value[0]))
+                { (*Opt).cache_MB = stod(value); }
+            else if (option == "--ooc-mb" && value != "" && isdigit(value[0]))
+                { (*Opt).ooc_MB = stod(value); }
+            else if (option == "--layout" && value == "auto")
+                { (*Opt).layout = LAYOUT_AUTO; }
+            else if (option == "--layout" && value == "raw")
+                { (*Opt).layout = LAYOUT_RAW; }
+            else if (option == "--layout" && value == "weighted")
+                { (*Opt).layout = LAYOUT_WEIGHTED; }
             else 
             {
                 cout << endl << "ERROR: The arguments are not correct." << endl;
                 HELP_message();
                 return 0; 
             }
+            i += 2;
+        }
+
+    /**********************     EXHAUSTIVE SEARCH: CHECK n    ********************/
+        // the Walsh-Hadamard transform needs 2^n integers in memory; the other engines compute and rank the 2^n operators one by one:
+        unsigned int n_max_exhaustive = ((*Opt).wht)? 34 : 24;
+
+        if (flag_search == 1 && (*n) > n_max_exhaustive)  // Varying basis search with default k_max
+        {
+            cout << "The Exhaustive Search is not recommended for dataset with more than n~" << n_max_exhaustive << " variables." << endl;
+            cout << "We Recommend to use the heuristic procedure instead." << endl;
+            flag_search = 3;
         }
     }
 
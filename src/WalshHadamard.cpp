@@ -0,0 +1,216 @@
+#include <iostream>
+#include <set>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+
+#include <ctime> // for chrono
+#include <ratio> // for chrono
+#include <chrono> // for chrono
+
+using namespace std;
+
+/******************************************************************************/
+/**********************     CONSTANTS  and TOOLS  *****************************/
+/******************************************************************************/
+#include "data.h"
+const uint64_t one64 = 1;
+
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const function<void(uint64_t, uint64_t, uint64_t)>& work);
+
+// Blocking of the transform:
+const unsigned int WHT_block_levels = 12;  // the 12 first levels are done inside blocks of 2^12 values (16 kB or 32 kB: fit in the L1/L2 cache)
+const unsigned int WHT_group_levels = 8;   // the next levels are done 8 by 8, on groups of 2^8 strided rows ..
+const size_t WHT_chunk = 64;               // .. of 64 contiguous values each (2^8 x 64 values: fit in the L2 cache)
+
+/******************************************************************************/
+/*********************     IN-PLACE WALSH-HADAMARD TRANSFORM    ***************/
+/******************************************************************************/
+// One butterfly on two contiguous rows of 'len' values:  (a, b) --> (a+b, a-b)
+// The rows don't overlap: the loop is vectorized by the compiler (-O3 -march=native).
+template <typename T>
+inline void Butterfly(T* __restrict p, T* __restrict q, size_t len)
+{
+  for (size_t j = 0; j < len; j++)
+  {
+    T a = p[j], b = q[j];
+    p[j] = a + b;
+    q[j] = a - b;
+  }
+}
+
+// Levels h = 1, 2, .., 2^(b-1) of the transform, on the block x[0, 2^b):
+template <typename T>
+void WHT_Block(T* x, unsigned int b)
+{
+  size_t size = ((size_t) 1) << b;
+  for (size_t h = 1; h < size; h <<= 1)
+  {
+    for (size_t i = 0; i < size; i += 2*h)
+      {   Butterfly(x + i, x + i + h, h);   }
+  }
+}
+
+// Levels h = h0, 2*h0, .., h0*2^(r-1) of the transform, on the 2^r rows x[u*h0, u*h0 + len) for u = 0, .., 2^r-1:
+// the butterflies of the r levels are done between these rows.
+template <typename T>
+void WHT_Group(T* x, size_t h0, unsigned int r, size_t len)
+{
+  size_t Nrows = ((size_t) 1) << r;
+  for (size_t h = 1; h < Nrows; h <<= 1)
+  {
+    for (size_t t = 0; t < Nrows; t += 2*h)
+    {
+      for (size_t u = t; u < t + h; u++)
+        {   Butterfly(x + u*h0, x + (u+h)*h0, len);   }
+    }
+  }
+}
+
+// In-place (unnormalized) Walsh-Hadamard transform of x[0, 2^n):
+//   x[Op] <-- sum_s x[s] (-1)^{parity(s & Op)}
+// Complexity = O(n 2^n), with (n - 12) / 8 + 1 passes over the memory:
+//   -- the 12 first levels are done block by block (each block stays in cache);
+//   -- the next levels are done 8 at a time, on groups of 2^8 strided rows of 64 contiguous values.
+// The blocks and groups are independent: they are distributed over 'Nthreads' threads.
+template <typename T>
+void WHT_InPlace(T* x, unsigned int n, unsigned int Nthreads)
+{
+  unsigned int b = (n < WHT_block_levels)? n : WHT_block_levels;
+  size_t size = ((size_t) 1) << n, B = ((size_t) 1) << b;
+  uint64_t Nranges = 64 * ((uint64_t) Nthreads);
+
+  // Levels 1 to 2^(b-1):
+  Parallel_Ranges(size / B, Nthreads, Nranges, [&](uint64_t, uint64_t start, uint64_t count)
+  {
+    for (uint64_t blk = start; blk < start + count; blk++)
+      {   WHT_Block(x + blk * B, b);   }
+  });
+
+  // Levels 2^b to 2^(n-1):
+  for (unsigned int l = b; l < n; l += WHT_group_levels)
+  {
+    unsigned int r = ((n - l) < WHT_group_levels)? (n - l) : WHT_group_levels;
+    size_t h0 = ((size_t) 1) << l;
+    size_t G = h0 << r;                  // length of a group
+    uint64_t Nchunks = h0 / WHT_chunk;   // number of chunks of columns in a group (h0 >= 2^12 is a multiple of 64)
+
+    Parallel_Ranges((size / G) * Nchunks, Nthreads, Nranges, [&](uint64_t, uint64_t start, uint64_t count)
+    {
+      for (uint64_t task = start; task < start + count; task++)
+        {   WHT_Group(x + (task / Nchunks) * G + (task % Nchunks) * WHT_chunk, h0, r, WHT_chunk);   }
+    });
+  }
+}
+
+/******************************************************************************/
+/*********************     SPECTRUM OF THE DATA    ****************************/
+/******************************************************************************/
+// Histogram of the states over the 2^n possible states, then in-place transform:
+template <typename T>
+void Spectrum_Values(vector<T>& W, const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, unsigned int Nthreads)
+{
+  W.assign(((size_t) 1) << n, 0);
+
+  for (auto& it : Nvect)
+    {   W[(uint64_t) it.first] += (T) it.second;   }
+
+  WHT_InPlace(W.data(), n, Nthreads);
+}
+
+// Values of all the 2^n operators at once: K1(Op) = (N - W[Op]) / 2
+// Complexity = O(|Nset| + n 2^n), Memory = 2^n * (4 or 8) bytes
+Spectrum Build_Spectrum(const vector<pair<__int128_t, uint64_t>>& Nvect, unsigned int n, uint64_t N, unsigned int Nthreads = 1)
+{
+  auto start = chrono::system_clock::now();
+
+  cout << "--->> Walsh-Hadamard transform of the histogram of the data (values of all the 2^n operators):" << endl;
+
+  Spectrum Data;
+  Data.n = n;
+  Data.N = N;
+
+  if (N < (one64 << 31))
+    {   Spectrum_Values(Data.W32, Nvect, n, Nthreads);   }
+  else
+    {   Spectrum_Values(Data.W64, Nvect, n, Nthreads);   }
+
+  auto end = chrono::system_clock::now();  chrono::duration<double> elapsed = end - start;
+
+  cout << "\t Number of values = 2^" << n << ", \t stored on " << ((Data.W64.empty())? 32 : 64) << " bits";
+  cout << ", \t Memory = " << (Data.W32.size() * sizeof(int32_t) + Data.W64.size() * sizeof(int64_t)) / 1024. / 1024. << " MB" << endl;
+  cout << "\t Elapsed time (in s): " << elapsed.count() << endl << endl;
+
+  return Data;
+}
+
+/******************************************************************************/
+/**************     HISTOGRAM and EXTRACTION of the SPECTRUM    ***************/
+/******************************************************************************/
+// The bias of an operator only depends on |W[Op]| = |2*K1 - N|:  bias = |W[Op]| / 2N.
+// The operators are counted in buckets of |W| of width 2^shift, with at most 2^20 buckets:
+unsigned int Spectrum_Bucket_Shift(uint64_t N)
+{
+  unsigned int shift = 0;
+  while ((((uint64_t) N) >> shift) >= (one64 << 20))  {   shift++;   }
+  return shift;
+}
+
+// Number of operators in each bucket:  Histo[b] = nb of operators 'Op != 0' with  (|W[Op]| >> shift) = b
+// Complexity = O(2^n), one histogram per thread:
+vector<uint64_t> Spectrum_Histogram(const Spectrum& Data, unsigned int shift, unsigned int Nthreads = 1)
+{
+  size_t Nbuckets = (((uint64_t) Data.N) >> shift) + 1;
+  vector<vector<uint64_t>> Histo_thread(Nthreads, vector<uint64_t>(Nbuckets, 0));
+
+  Parallel_Ranges((one64 << Data.n) - 1, Nthreads, Nthreads, [&](uint64_t range, uint64_t start, uint64_t count)
+  {
+    vector<uint64_t>& Histo = Histo_thread[range];
+    for (uint64_t Op = start + 1; Op <= start + count; Op++)
+      {   Histo[((uint64_t) llabs(Data.W(Op))) >> shift]++;   }
+  });
+
+  vector<uint64_t> Histo(Nbuckets, 0);
+  for (auto& H : Histo_thread)
+  {
+    for (size_t b = 0; b < Nbuckets; b++)  {   Histo[b] += H[b];   }
+  }
+  return Histo;
+}
+
+// All the operators 'Op != 0' with |W[Op]| >= W_min, by increasing value of 'Op':
+vector<uint64_t> Spectrum_Extract(const Spectrum& Data, uint64_t W_min, unsigned int Nthreads = 1)
+{
+  uint64_t Nranges = 64 * ((uint64_t) Nthreads);
+  vector<vector<uint64_t>> Buffer(Nranges);
+
+  Parallel_Ranges((one64 << Data.n) - 1, Nthreads, Nranges, [&](uint64_t range, uint64_t start, uint64_t count)
+  {
+    for (uint64_t Op = start + 1; Op <= start + count; Op++)
+    {
+      if (((uint64_t) llabs(Data.W(Op))) >= W_min)  {   Buffer[range].push_back(Op);   }
+    }
+  });
+
+  vector<uint64_t> OpList;
+  for (auto& B : Buffer)
+    {   OpList.insert(OpList.end(), B.begin(), B.end());   }
+  return OpList;
+}
+
+/******************************************************************************/
+/*********************     VALUE of an OPERATOR    ****************************/
+/******************************************************************************/
+// ******* Data averages are taken using ISING convention: ******************** /
+Operator128 Value_Op(__int128_t Op_bin, const Spectrum& Data, double Nd)
+{
+  Operator128 Op;
+
+  Op.bin = Op_bin;
+  Op.k1 = Data.K1((uint64_t) Op_bin);
+  Op.bias = fabs((((double) Op.k1) / Nd) -0.5);  //fabs(p1-0.5);
+
+  return Op;
+}
@@ -25,7 +25,7 @@ unsigned int bitset_count(__int128_t bool_nb);
 struct Operator128
 {
   __int128_t bin;     // binary representation of the operator
-  unsigned int k1;  // nb of datapoints for which Op = 1 --> it's a R.V.:  k1 = sum(op[s^i])
+  uint64_t k1;      // nb of datapoints for which Op = 1 --> it's a R.V.:  k1 = sum(op[s^i])
   unsigned int r;   // nb of basis 
 
   double bias;     // bias = fabs(p1-0.5)
@@ -36,42 +36,417 @@ struct Operator128
 struct Struct_LowerBound
 {
   double Bias = 0.;
-  unsigned int Index = 0.;
+  uint64_t Index = 0.;
 };
 
+/********************************************************************/
+/**********************    SET OF OPERATORS    **********************/
+/********************************************************************/
+// Candidate operator, in a compact form (24 bytes): the operator and its number of datapoints with Op = 1
+struct Candidate128
+{
+  uint64_t bin_lo;    // lowest 64 bits of the operator
+  uint64_t bin_hi;    // highest 64 bits of the operator
+  uint64_t k1;        // nb of datapoints for which Op = 1
 
-class MatrixF2 {
-  public:
-  unsigned int n; // = Number of spins = number of rows --> 1rst index  
-  unsigned int m; // = Number of selected operators = number of columns --> 2nd index
-  bool** M;       // = boolean Matrix
+  __int128_t bin() const  {   return (__int128_t) ((((unsigned __int128) bin_hi) << 64) | bin_lo);   }
+};
+
+// Set of operators ranked from the most to the less likely, stored in a flat sorted vector (see 'OpSet.cpp'):
+// ranking key = |2*K1 - N| (decreasing, i.e. decreasing bias), then order of the operator (increasing), then operator (increasing);
+// this is the ranking of 'Operator128'.
+struct OpSet128
+{
+  uint64_t N = 0;             // number of datapoints
+  std::vector<Candidate128> Op;   // Op[0] is the most biased operator
+
+  size_t size() const  {   return Op.size();   }
+  Operator128 at(size_t i) const;   // operator 'i' with its bias
+};
+
+/********************************************************************/
+/*************************    ECHELON BASIS    **********************/
+/********************************************************************/
+// Set of independent operators kept in echelon form, to build a basis one operator at a time (see 'ExtractBasis_inOpSet.cpp'):
+// Pivot[i] = operator whose highest bit is bit 'i' (0 if there is none); the pivots are independent, and span the same space as the operators added.
+// An operator is reduced by XOR-ing the pivot of its highest bit until it is 0 (dependent), or its highest bit has no pivot (independent).
+struct Echelon_Basis
+{
+  unsigned int rank = 0;       // number of independent operators added
+  __int128_t Pivot[128] = {};
+};
+
+/********************************************************************/
+/**************    COMBINATIONS of k VARIABLES    *******************/
+/********************************************************************/
+// Indices i_0 < i_1 < ... < i_{k-1} of a combination of k variables among n, enumerated in lexicographic order.
+// The order k is either fixed at compilation (K = 2, ..., K_unrolled), in which case all the loops over the indices
+// are unrolled by the compiler, or given at run time (K = 0);  the enumerations are dispatched on k by the loops
+// over the operators (see 'AllOp_kbits_Loop' in 'Init_OpSet.cpp', 'BitSliced.cpp' and 'Sparse.cpp').
+const unsigned int K_unrolled = 6;
+
+template <unsigned int K>
+struct Combination
+{
+  unsigned int n = 0;
+  unsigned int k_run = 0;                 // order given at run time (K = 0 only)
+  unsigned int idx[(K > 0)? K : 128];
+
+  Combination(unsigned int n_, unsigned int k_) : n(n_), k_run(k_) {}
+  unsigned int k() const  {   return (K > 0)? K : k_run;   }
+
+  __int128_t bin() const
+  {
+    __int128_t Op = 0;
+    for (unsigned int l = 0; l < k(); l++)  {   Op |= ((__int128_t) 1) << idx[l];   }
+    return Op;
+  }
+
+  // Next combination of the k-1 first indices (the last one is set just after them):
+  // returns the first level 'd' that changed, or -1 if it was the last one.
+  int next_prefix()
+  {
+    int d = ((int) k()) - 2;
+    while (d >= 0 && idx[d] == n - k() + d)  {   d--;   }
+    if (d < 0)  {   return -1;   }
+
+    idx[d]++;
+    for (unsigned int l = d + 1; l < k(); l++)  {   idx[l] = idx[l-1] + 1;   }
+    return d;
+  }
+
+  // Next combination;  returns 'false' if it was the last one:
+  bool next()
+  {
+    if (idx[k()-1] + 1 < n)  {   idx[k()-1]++;   return true;   }   // most frequent case: only the last index moves
+    return next_prefix() >= 0;
+  }
+};
+
+/********************************************************************/
+/********************    FLOOR of the ENUMERATION    ****************/
+/********************************************************************/
+// Lower bound raised during the enumeration of the operators (see 'OpSet.cpp'), shared by the threads:
+// the best basis is built greedily (matroid), so as soon as the operators seen so far contain 'n' independent operators,
+// the smallest |2*K1 - N| among the most biased of them is a floor for the basis: operators below it can be rejected.
+#include <atomic>
+#include <mutex>
+
+const size_t Floor_batch = 1024;    // number of operators accepted in all the buffers between two checks against the floor
+
+struct Struct_Floor
+{
+  uint64_t N = 0;
+  unsigned int n = 0;
+  std::atomic<uint64_t> W;          // operators with |2*K1 - N| < W are rejected (0 = no floor yet)
+  std::vector<Candidate128> Seed;   // greedy basis of the operators seen so far (ranked), shared by the ranges
+  std::mutex Seed_mutex;            // protects 'Seed' during the enumeration
+  std::atomic<uint64_t> Nbuffered;  // number of operators added to the buffers of all the ranges
+  std::atomic<uint64_t> Next;       // value of 'Nbuffered' at which the next check is done
+
+  Struct_Floor() : W(0), Nbuffered(0), Next(Floor_batch) {}
+  bool accept(uint64_t K1) const
+  {
+    int64_t W_op = 2 * ((int64_t) K1) - ((int64_t) N);
+    return ((uint64_t) ((W_op < 0)? -W_op : W_op)) >= W.load(std::memory_order_relaxed);
+  }
+};
+
+// State of the buffer of a range for the checks against the floor (see 'Check_Floor' in 'OpSet.cpp'):
+struct Floor_Check
+{
+  size_t Nseen = 0;        // size of the buffer already counted in 'Nbuffered'
+  size_t next_size = 0;    // size of the buffer below which it is not checked again (twice its size after its last check)
+};
+
+/********************************************************************/
+/*****************    CACHE of the VALUES in R0    ******************/
+/********************************************************************/
+// Mixing of the two halves of a 128-bit integer for the hash tables (use the highest bits of the result):
+inline uint64_t Hash128(__int128_t x)
+  {   return (((uint64_t) x) ^ (((uint64_t) (((unsigned __int128) x) >> 64)) * 0x9E3779B97F4A7C15ULL)) * 0xC2B2AE3D27D4EB4FULL;   }
+
+// Values K1 of the operators already computed in the previous representations (see 'Cache_R0.cpp'):
+// an operator 'Op' of the representation Ri is the operator  image(Op) = XOR of Row[i] for the bits 'i' of Op  of the original
+// representation R0, with the same K1;  the cache is a hash table (open addressing) of the images in R0, with a capped memory.
+// The table is only read during the enumeration of the operators; the new values are added between two enumerations.
+struct Cache_R0
+{
+  size_t Nslots_max = 0;             // memory cap (in number of slots); 0 = no cache
+  size_t Nentries = 0;               // number of values stored (at most half of the slots)
+  std::vector<Candidate128> Slot;    // slot = (image in R0, K1);  empty slot = image 0
+  __int128_t Row[128] = {};          // image in R0 of the variable 'i' of the current representation
+  mutable std::atomic<uint64_t> Nhits;   // number of values read from the cache
+  size_t room_per_range = 0;         // number of new values that each range of the enumeration can record
+
+  Cache_R0() : Nhits(0) {}
 
-  unsigned int OpSet_offset=0; // number of Operators already analysed
+  __int128_t image(__int128_t Op) const
+  {
+    __int128_t Img = 0;
+    for (unsigned int i = 0; Op; i++, Op >>= 1)
+      {   if (Op & 1)  {   Img ^= Row[i];   }   }
+    return Img;
+  }
+
+  size_t hash(__int128_t Img) const
+    {   return (size_t) (Hash128(Img) >> 17) & (Slot.size() - 1);   }
+
+  bool find(__int128_t Img, uint64_t* K1) const
+  {
+    if (Nentries == 0)  {   return false;   }
+    uint64_t lo = (uint64_t) Img, hi = (uint64_t) (((unsigned __int128) Img) >> 64);
+    for (size_t s = hash(Img); Slot[s].bin_lo | Slot[s].bin_hi; s = (s + 1) & (Slot.size() - 1))
+    {
+      if (Slot[s].bin_lo == lo && Slot[s].bin_hi == hi)  {   *K1 = Slot[s].k1;   return true;   }
+    }
+    return false;
+  }
+
+  // K1 of the operator of image 'Img': read from the cache, or computed with 'Compute_K1()' and recorded in 'Missed' (while there is room):
+  template <typename ComputeFunction>
+  uint64_t K1(__int128_t Img, std::vector<Candidate128>& Missed, uint64_t* hits, ComputeFunction Compute_K1) const
+  {
+    uint64_t k1 = 0;
+    if (find(Img, &k1))  {   (*hits)++;   return k1;   }
+
+    uint64_t K1 = Compute_K1();
+    record(Img, K1, Missed);
+    return K1;
+  }
+
+  // Record a value that was not in the cache in 'Missed' (while there is room):
+  void record(__int128_t Img, uint64_t K1, std::vector<Candidate128>& Missed) const
+  {
+    if (Missed.size() < room_per_range)
+      {   Missed.push_back({(uint64_t) Img, (uint64_t) (((unsigned __int128) Img) >> 64), K1});   }
+  }
+};
+
+/********************************************************************/
+/********************    HISTOGRAM of the STATES    *****************/
+/********************************************************************/
+// Histogram of the states in an open-addressing hash table (linear probing, at most half full; see 'Histogram.cpp'):
+// no allocation per state, the table is doubled when needed.
+struct Histogram128
+{
+  unsigned int shift = 64;    // slot of a state = Hash128(state) >> shift
+  size_t Nentries = 0;        // number of different states
+  std::vector<std::pair<__int128_t, uint64_t>> Slot;   // (state, count);  count = 0 for an empty slot
 
-  // constructor: 
-  MatrixF2(unsigned int n_, unsigned int m_) {
-    n = n_;
-    m = m_;
+  void grow();                // double the table (defined in 'Histogram.cpp')
+  void add(__int128_t state, uint64_t count)
+  {
+    if (count == 0)  {   return;   }
+    if (2 * (Nentries + 1) > Slot.size())  {   grow();   }
 
-    // Create a Boolean Matrix:
-    M = (bool**) malloc(n*sizeof(bool*));  // n rows --> 1rst index
-    for (int i=0; i<n; i++)
-      {   M[i] = (bool*) malloc(m * sizeof(bool));  }  // m columns --> 2nd index
+    size_t mask = Slot.size() - 1;
+    for (size_t s = Hash128(state) >> shift; ; s = (s + 1) & mask)
+    {
+      if (Slot[s].second == 0)  {   Slot[s] = {state, count};   Nentries++;   return;   }
+      if (Slot[s].first == state)  {   Slot[s].second += count;   return;   }
     }
+  }
+};
+
+/********************************************************************/
+/***********************    SEARCH OPTIONS    ***********************/
+/********************************************************************/
+// Engines available to compute the values of the operators on the data:
+enum Engine
+{
+  ENGINE_ROWS = 0,      // loop over the states of the histogram, stored as a structure of arrays (one pass per operator, see 'Rows.cpp')
+  ENGINE_BITSLICED = 1, // XOR of the columns of the bit-sliced data + popcount (see 'BitSliced.cpp')
+  ENGINE_SPARSE = 2     // sorted lists of the rows in which each variable is 1 (compressed sparse columns, see 'Sparse.cpp')
+};
+
+// Layout of the rows of the bit-sliced data:
+enum Layout
+{
+  LAYOUT_AUTO = 0,     // choose the cheapest of the two layouts below from N / |Nset|
+  LAYOUT_RAW = 1,      // one row per datapoint:  N rows
+  LAYOUT_WEIGHTED = 2  // one row per different state (|Nset| rows) + the counts of each state stored in bit-planes
+};
+
+// Options of the search, that can be changed from the command line (see 'User_Interface.cpp'):
+struct Struct_Options
+{
+  Engine engine = ENGINE_BITSLICED;
+  Layout layout = LAYOUT_AUTO;
+  unsigned int threads = 1;   // number of threads used to evaluate the operators of order k >= 2
+  bool mitm = false;   // k=4 operators built as XOR of two cached order-2 parity columns (meet-in-the-middle, bitsliced engine only)
+  bool wht = true;     // exhaustive search: all the 2^n operators obtained at once from the Walsh-Hadamard transform of the histogram
+  double cache_MB = 512;   // varying representation: memory of the cache of the values of the operators in R0 (0 = no cache)
+  bool index = true;        // fixed and varying representation, bitsliced engine: bit-sliced data read from (or written to) an index file in INPUT/
+  double ooc_MB = 0;        // out-of-core reading of the datafile, with at most about 'ooc_MB' MB of states in memory (0 = read in memory)
+  bool write_nset = false;  // only write the histogram of the data in a binary '.nset' file (see 'ReadDataFile.cpp'), then stop
+  bool pairs = true;        // operators of order 2 obtained from the co-occurrence matrix of the variables (see 'Cooccurrence.cpp')
+  bool write_pairs = false; // write the co-occurrence matrix of the data in OUTPUT/, before the search
+  double sparse_density = 1./128;  // bitsliced engine: sparse columns used instead when the fraction of 1's in the columns is below this value
+};
+
+/********************************************************************/
+/**********************    BIT-SLICED DATA    ***********************/
+/********************************************************************/
+// Transposed (column-major) copy of the data: one packed bitvector per variable.
+// Column 'i' contains the values of the variable encoded in bit 'i' of the states (i=0 is the rightmost variable),
+// each row being one bit of each column.
+// The values of an operator on all the rows is then the XOR of the columns of the variables it contains.
+//  -- RAW layout:  each datapoint is one row;
+//  -- WEIGHTED layout:  each different state of Nvect is one row, and its count is written in binary in the bit-planes:
+//       bit 'b' of the count of row 'r' = bit 'r' of plane 'b';  then  K1 = sum_b 2^b * popcount(parity & plane_b).
+// The columns and planes can also be read directly from an index file mapped in memory (see 'BitSliced_Index.cpp').
+#include <memory>
 
-  // destructor:
-  ~MatrixF2() {
-    //std::cout << "Object MatrixF2 is being deleted" << std::endl;
-    for (int i=0; i<n; i++)
-      {   free(M[i]);  }
-    free(M);
+struct BitSliced
+{
+  unsigned int n = 0;       // number of variables = number of columns
+  uint64_t N = 0;       // number of datapoints
+  uint64_t Nrows = 0;       // number of rows stored in each column
+  uint64_t Nwords = 0;      // number of 64-bit words per column: rows are packed 64 by 64, the last word is padded with 0's
+
+  std::vector<uint64_t> Col;  // column 'i' is stored in the words [i*Nwords, (i+1)*Nwords)
+
+  bool weighted = false;        // true for the WEIGHTED layout
+  unsigned int Nplanes = 0;     // number of bit-planes = number of bits of the largest count (0 for the RAW layout)
+  std::vector<uint64_t> Plane;  // plane 'b' is stored in the words [b*Nwords, (b+1)*Nwords)
+
+  // Index file mapped in memory (read-only): its columns and planes are used instead of 'Col' and 'Plane'.
+  // The file stays mapped as long as one copy of the data uses it.
+  const uint64_t* Col_map = nullptr;
+  const uint64_t* Plane_map = nullptr;
+  std::shared_ptr<const void> Mapping;
+
+  const uint64_t* column(unsigned int i) const  {   return ((Col_map)? Col_map : Col.data()) + ((size_t) i) * Nwords;   }
+  const uint64_t* plane(unsigned int b) const  {   return ((Plane_map)? Plane_map : Plane.data()) + ((size_t) b) * Nwords;   }
+};
+
+/********************************************************************/
+/*********************    ROW-MAJOR DATA (SoA)    *******************/
+/********************************************************************/
+// Allocator of arrays aligned on a cache line (64 bytes), for the aligned SIMD loads:
+#include <cstdlib>
+#include <new>
+
+template <typename T>
+struct Aligned_Allocator
+{
+  typedef T value_type;
+
+  Aligned_Allocator() {}
+  template <typename U> Aligned_Allocator(const Aligned_Allocator<U>&) {}
+
+  T* allocate(size_t count)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, 64, count * sizeof(T)) != 0)  {   throw std::bad_alloc();   }
+    return (T*) p;
   }
+  void deallocate(T* p, size_t)  {   free(p);   }
+};
+template <typename T, typename U> bool operator==(const Aligned_Allocator<T>&, const Aligned_Allocator<U>&)  {   return true;   }
+template <typename T, typename U> bool operator!=(const Aligned_Allocator<T>&, const Aligned_Allocator<U>&)  {   return false;   }
+
+// Copy of the histogram Nvect in three separate arrays (structure of arrays, see 'Rows.cpp'):
+// row 'r' = state (Lo[r], Hi[r]) with the count Count[r];  the arrays are padded with rows of count 0 up to a multiple of 8 rows.
+// An operator is evaluated on 4 or 8 rows per instruction:  K1 = sum_r Count[r] * parity(state_r & Op).
+// This is the engine used when the bit-sliced data doesn't pay off (small N, or very large |Nset|).
+// The operators are evaluated by blocks of 'Rows_batch' operators: the rows are read by tiles of 'Rows_tile' rows,
+// and each tile (16 or 24 kB, in the L1 cache) is used by all the operators of the block before the next tile is read.
+const size_t Rows_tile = 1024;    // multiple of 8
+const size_t Rows_batch = 128;
+struct Rows128
+{
+  unsigned int n = 0;       // number of variables
+  uint64_t N = 0;           // number of datapoints
+  uint64_t Nrows = 0;       // number of different states (without the padding)
+  bool wide = false;        // true if some states have bits above bit 63 (the array 'Hi' is then read)
+
+  std::vector<uint64_t, Aligned_Allocator<uint64_t>> Lo;      // lowest 64 bits of the states
+  std::vector<uint64_t, Aligned_Allocator<uint64_t>> Hi;      // highest 64 bits of the states
+  std::vector<uint64_t, Aligned_Allocator<uint64_t>> Count;   // number of datapoints in each state
+};
+
+/********************************************************************/
+/*******************    SPARSE COLUMNS of the DATA    ***************/
+/********************************************************************/
+// Compressed sparse columns (see 'Sparse.cpp'): for each variable, the sorted list of the rows in which it is equal to 1.
+// The rows are the ones of the bit-sliced data (datapoints for the RAW layout, different states for the WEIGHTED layout).
+// The value of an operator is computed on the lists of its variables, in a time proportional to their number of 1's
+// (and not to the number of rows):  for two sets of rows A and B,  K1(A XOR B) = w(A) + w(B) - 2 w(A & B),
+// where w() is the number of datapoints in a set of rows.
+struct SparseColumns
+{
+  unsigned int n = 0;       // number of variables = number of columns
+  uint64_t N = 0;           // number of datapoints
+  uint64_t Nrows = 0;       // number of rows (less than 2^32)
+
+  std::vector<uint64_t> Start;    // the rows of column 'i' are Row[Start[i], Start[i+1])
+  std::vector<uint32_t> Row;
+  std::vector<uint64_t> Weight;   // Weight[i] = number of datapoints in which variable 'i' is 1
+  std::vector<uint64_t> Count;    // number of datapoints in each row (WEIGHTED layout);  empty = one datapoint per row
+
+  const uint32_t* column(unsigned int i) const  {   return Row.data() + Start[i];   }
+  uint64_t size(unsigned int i) const  {   return Start[i+1] - Start[i];   }
+};
+
+/********************************************************************/
+/*******************    WALSH-HADAMARD SPECTRUM    ******************/
+/********************************************************************/
+// Walsh-Hadamard transform of the histogram of the states, over the 2^n possible states (see 'WalshHadamard.cpp'):
+//    W[Op] = sum_s N(s) (-1)^{parity(s & Op)} = N - 2*K1(Op)     for all the 2^n operators 'Op'.
+// The values are in [-N, N]: they are stored on 32 bits when N < 2^31 (half the memory, twice the SIMD width), on 64 bits otherwise.
+struct Spectrum
+{
+  unsigned int n = 0;       // number of variables: the spectrum has 2^n values
+  uint64_t N = 0;       // number of datapoints
+
+  std::vector<int32_t> W32;  // used if N < 2^31
+  std::vector<int64_t> W64;  // used otherwise
+
+  int64_t W(uint64_t Op) const  {   return (W64.empty())? W32[Op] : W64[Op];   }
+  uint64_t K1(uint64_t Op) const  {   return (uint64_t) ((((int64_t) N) - W(Op)) / 2);   }
+};
+
+
+/********************************************************************/
+/*********************    CO-OCCURRENCE MATRIX    *******************/
+/********************************************************************/
+// Number of datapoints in which two variables are both equal to 1 (see 'Cooccurrence.cpp'):
+//    C[i*n + j] = c_ij = #{datapoints with s_i = 1 and s_j = 1},   and  C[i*n + i] = c_i = #{datapoints with s_i = 1}.
+// The values of all the operators of order 2 follow:   K1(s_i + s_j) = c_i + c_j - 2*c_ij.
+struct Cooccurrence
+{
+  unsigned int n = 0;       // number of variables
+  uint64_t N = 0;           // number of datapoints
+  std::vector<uint64_t> C;  // symmetric n x n matrix
+
+  uint64_t at(unsigned int i, unsigned int j) const  {   return C[((size_t) i) * n + j];   }
+  uint64_t K1_pair(unsigned int i, unsigned int j) const  {   return at(i, i) + at(j, j) - 2 * at(i, j);   }
+};
+
+/********************************************************************/
+/************************    MATRIX over F2    **********************/
+/********************************************************************/
+// Matrix over F2 with at most 128 columns (see 'ExtractBasis_inOpSet.cpp'):
+// row 'i' is packed in the word Row[i], whose bit 'j' is the element (i, j);  adding two rows is a single 128-bit XOR.
+// A set of operators is written as the matrix whose rows are the operators (bit 'j' of row 'i' = bit 'j' of the operator 'i').
+class MatrixF2 {
+  public:
+  unsigned int n; // = Number of rows --> 1rst index
+  unsigned int m; // = Number of columns --> 2nd index  (m <= 128)
+  std::vector<__int128_t> Row;   // = rows of the matrix
+
+  // constructor: zero matrix
+  MatrixF2(unsigned int n_ = 0, unsigned int m_ = 0) : n(n_), m(m_), Row(n_, 0) {}
+
+  bool get(unsigned int i, unsigned int j) const  {   return (Row[i] >> j) & 1;   }
 };
 
 /*
 class Data {   // ***** The data is stored in Nvect as an histogram:  
   unsigned int n;  // number of binary variables
-  unsigned int N;  // total number of datapoints
+  uint64_t N;  // total number of datapoints
 
   vector<pair<uint64_t, unsigned int>> Nvect; // Nvect[mu] = #of time state mu appears in the data set
 };
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>  // for std::reverse()
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 /******************************************************************************/
 /***************************   Constant variables   ***************************/
@@ -151,10 +156,74 @@ void int_to_digits_file_reverse(__int128_t bool_nb, unsigned int r, std::fstream
 /********************************   N CHOOSE K   ******************************/
 /******************************************************************************/
 
-unsigned int Choose(unsigned int n, unsigned int k)
+// Exact computation with integers: at step i, res = C(n-k+i, i);
+// returns UINT64_MAX if the result doesn't fit in 64 bits
+uint64_t Choose(unsigned int n, unsigned int k)
 {
-    double res = 1;
+    if (k > n)  {   return 0;   }
+
+    unsigned __int128 res = 1;
     for (unsigned int i = 1; i <= k; ++i)
-        res = res * (n - k + i) / ((double) i);
-    return (unsigned int)(res + 0.01);
+    {
+        res = res * (n - k + i) / i;
+        if (res > UINT64_MAX)  {   return UINT64_MAX;   }
+    }
+    return (uint64_t) res;
+}
+
+/******************************************************************************/
+/*********************   COMBINATIONS of k INDICES among n   ******************/
+/******************************************************************************/
+// Combinations are sets of k indices  idx[0] < idx[1] < ... < idx[k-1]  in {0, ..., n-1},
+// ranked in lexicographic order (from 0 to C(n,k)-1);  the next combination is given by 'Combination' (see data.h)
+
+// Combination with rank 'rank':
+void Unrank_Combination(uint64_t rank, unsigned int n, unsigned int k, unsigned int* idx)
+{
+    unsigned int x = 0;
+    uint64_t c = 0;
+
+    for (unsigned int d = 0; d < k; d++)
+    {
+        c = Choose(n - x - 1, k - d - 1);  // number of combinations with idx[d] = x
+        while (rank >= c)
+        {
+            rank -= c;  x++;
+            c = Choose(n - x - 1, k - d - 1);
+        }
+        idx[d] = x;
+        x++;
+    }
+}
+
+/******************************************************************************/
+/***********************   PARALLEL LOOP over RANGES   ************************/
+/******************************************************************************/
+// Split the indices [0, total) into 'Nranges' balanced ranges, processed by 'Nthreads' threads:
+// each thread takes the next range that hasn't been processed yet (shared counter),
+// so that the threads that finish early take over the remaining work.
+// The function 'work(range, start, count)' is called once for each range.
+void Parallel_Ranges(uint64_t total, unsigned int Nthreads, uint64_t Nranges, const std::function<void(uint64_t, uint64_t, uint64_t)>& work)
+{
+    if (Nranges > total)  {   Nranges = total;   }
+    if (Nranges == 0)  {   return;   }
+
+    uint64_t size = total / Nranges, rest = total % Nranges;   // the 'rest' first ranges have one more element
+    std::atomic<uint64_t> next_range(0);
+
+    auto worker = [&]()
+    {
+        uint64_t range;
+        while ((range = next_range++) < Nranges)
+        {
+            uint64_t start = range * size + ((range < rest)? range : rest);
+            work(range, start, size + ((range < rest)? 1 : 0));
+        }
+    };
+
+    if (Nthreads <= 1)  {   worker();   return;   }
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < Nthreads; t++)  {   threads.push_back(std::thread(worker));   }
+    for (auto& th : threads)  {   th.join();   }
 }